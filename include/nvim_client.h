@@ -6,6 +6,8 @@
 #include <vector>
 #include <sys/types.h>
 
+struct iovec;
+
 namespace godot {
 
 class NvimClient {
@@ -19,7 +21,14 @@ public:
 	pid_t get_pid() const { return child_pid; }
 
 	size_t write(const uint8_t *p_data, size_t p_length);
+	// Writes segments in order until the pipe is full, without waiting for it to drain.
+	// r_written receives the bytes taken; returns false on a write error.
+	bool write_vectored(const struct iovec *p_segments, size_t p_count, size_t &r_written);
 	std::vector<uint8_t> read_available();
+	// Waits up to p_timeout_usec (rounded up to whole milliseconds) for output; true if there is some.
+	bool wait_readable(uint64_t p_timeout_usec);
+	// New close-on-exec descriptor for Neovim's stdout, owned by the caller; -1 if not running.
+	int duplicate_stdout_fd() const;
 
 private:
 	pid_t child_pid = -1;
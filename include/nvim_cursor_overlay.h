@@ -0,0 +1,98 @@
+#ifndef NVIM_CURSOR_OVERLAY_H
+#define NVIM_CURSOR_OVERLAY_H
+
+#include <godot_cpp/variant/color.hpp>
+#include <godot_cpp/variant/rid.hpp>
+#include <godot_cpp/variant/string.hpp>
+#include <godot_cpp/variant/vector2.hpp>
+
+#include "nvim_font_cache.h"
+#include "nvim_grid.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace godot {
+
+// One entry of Neovim's mode_info_set list.
+struct NvimCursorMode {
+	enum Shape {
+		SHAPE_BLOCK,
+		SHAPE_HORIZONTAL,
+		SHAPE_VERTICAL,
+	};
+
+	String name;
+	Shape shape = SHAPE_BLOCK;
+	int32_t cell_percentage = 100;
+	int64_t blinkwait = 0;
+	int64_t blinkon = 0;
+	int64_t blinkoff = 0;
+	int64_t attr_id = 0;
+};
+
+// Draws the cursor on its own canvas item above the grid rows. Moving the cursor only
+// changes the item's transform; the item is re-recorded when the shape, the colors or
+// the character under a block cursor change. Blinking toggles item visibility.
+class NvimCursorOverlay {
+public:
+	// Above every grid layer, including floating windows.
+	static constexpr int32_t DRAW_INDEX = 1 << 20;
+
+	NvimCursorOverlay() = default;
+	~NvimCursorOverlay();
+
+	void set_modes(const std::vector<NvimCursorMode> &p_modes, bool p_style_enabled);
+	void set_mode(int64_t p_mode_index);
+	void set_busy(bool p_busy);
+	void move(int64_t p_row, int64_t p_column);
+
+	// Repositions and, if needed, re-records the item for the cell currently under the cursor.
+	// p_cell is null when the cursor is not on a drawn grid; p_grid_origin is that grid's position.
+	void update(const RID &p_parent_item, NvimFontCache *p_fonts, const NvimCell *p_cell, const NvimPalette &p_palette, const Vector2 &p_grid_origin);
+	// Advances the blink timer; cheap when the current mode does not blink.
+	void process(double p_delta);
+	void release();
+
+	const NvimCursorMode &get_mode() const;
+
+private:
+	enum BlinkPhase {
+		BLINK_WAIT,
+		BLINK_ON,
+		BLINK_OFF,
+	};
+
+	std::vector<NvimCursorMode> modes;
+	bool style_enabled = false;
+	int64_t mode_index = 0;
+	bool busy = false;
+	int64_t row = 0;
+	int64_t column = 0;
+
+	RID item;
+	RID parent_item;
+	bool has_cell = false;
+	bool shown = false;
+	BlinkPhase blink_phase = BLINK_WAIT;
+	double blink_elapsed_ms = 0.0;
+	bool blink_visible = true;
+
+	// Last recorded content, so a plain move does not re-record the item.
+	uint64_t recorded_generation = 0;
+	Vector2 recorded_cell_size;
+	String recorded_text;
+	Color recorded_fill;
+	Color recorded_text_color;
+	NvimCursorMode::Shape recorded_shape = NvimCursorMode::SHAPE_BLOCK;
+	int32_t recorded_percentage = -1;
+	Vector2 cell_size = Vector2(8, 16);
+
+	bool _blinks() const;
+	void _restart_blink();
+	void _apply_visibility();
+};
+
+} // namespace godot
+
+#endif // NVIM_CURSOR_OVERLAY_H
@@ -0,0 +1,66 @@
+#ifndef NVIM_FONT_CACHE_H
+#define NVIM_FONT_CACHE_H
+
+#include <godot_cpp/classes/font.hpp>
+#include <godot_cpp/variant/packed_string_array.hpp>
+#include <godot_cpp/variant/rid.hpp>
+#include <godot_cpp/variant/string.hpp>
+
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace godot {
+
+// Owns the panel's fonts: loaded Font resources stay cached across Neovim restarts and
+// settings reloads, cell metrics are computed once per (font chain, size), and glyphs
+// missing from the primary font resolve through the configured fallback list with a
+// cached codepoint -> font map.
+class NvimFontCache {
+public:
+	struct Metrics {
+		float cell_width = 8.0f;
+		float cell_height = 16.0f;
+		float ascent = 12.0f;
+	};
+
+	// Returns true when the font chain or size changed. The size is re-resolved against the
+	// current theme on every call, so this is also what theme and editor setting changes call.
+	bool configure(const String &p_font_path, const PackedStringArray &p_fallback_paths, int32_t p_font_size);
+
+	// The primary font with the fallback chain attached, for shaping and draw_string.
+	Ref<Font> get_font() const { return chain_font; }
+	int32_t get_font_size() const { return font_size; }
+	const Metrics &get_metrics();
+	// Font cache RID and glyph index for a codepoint; an invalid RID means no font in the chain covers it.
+	RID resolve_glyph(char32_t p_codepoint, int64_t &r_glyph);
+	// Bumped whenever the chain or size changes, so renderers know to drop glyph caches.
+	uint64_t get_generation() const { return generation; }
+
+private:
+	struct ResolvedGlyph {
+		RID font_rid;
+		int64_t glyph = 0;
+	};
+
+	std::map<String, Ref<Font>> loaded_fonts;
+	std::vector<Ref<Font>> chain;
+	Ref<Font> chain_font;
+	int32_t font_size = 14;
+	uint64_t generation = 0;
+	// Keyed by the chain's font instance ids and the size; dropped when the chain changes.
+	std::map<std::pair<std::vector<uint64_t>, int32_t>, Metrics> metrics_cache;
+	std::vector<uint64_t> chain_ids;
+	const Metrics *current_metrics = nullptr;
+	std::unordered_map<char32_t, ResolvedGlyph> glyph_cache;
+
+	Ref<Font> _load(const String &p_path);
+	Ref<Font> _get_theme_font() const;
+	int32_t _resolve_font_size(int32_t p_configured_size) const;
+};
+
+} // namespace godot
+
+#endif // NVIM_FONT_CACHE_H
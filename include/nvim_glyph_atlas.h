@@ -0,0 +1,63 @@
+#ifndef NVIM_GLYPH_ATLAS_H
+#define NVIM_GLYPH_ATLAS_H
+
+#include <godot_cpp/classes/image.hpp>
+#include <godot_cpp/classes/image_texture.hpp>
+#include <godot_cpp/variant/packed_byte_array.hpp>
+#include <godot_cpp/variant/vector2i.hpp>
+
+#include "nvim_font_cache.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace godot {
+
+// Cell-sized glyph slots rasterized from the TextServer glyph cache into one RGBA8 image.
+// Slot 0 is always blank; alpha carries glyph coverage. Double-width glyphs (CJK, emoji)
+// take two adjacent slots on the same atlas row, left half first.
+class NvimGlyphAtlas {
+public:
+	static constexpr int32_t SLOTS_PER_ROW = 64;
+	static constexpr uint32_t MAX_SLOTS = 65535;
+	// OR'd into a codepoint to look up or add its double-width rasterization.
+	static constexpr char32_t WIDE_GLYPH = 0x80000000u;
+
+	// Rebuilds the atlas when the font cache generation or cell metrics changed.
+	void configure(NvimFontCache *p_fonts);
+	void clear();
+
+	// Returns the slot for a codepoint, or 0 if it is not in the atlas yet. For a
+	// WIDE_GLYPH key this is the left half; the right half is the next slot.
+	uint32_t find_slot(char32_t p_codepoint) const;
+	// Rasterizes every missing codepoint in one pass and returns true if the atlas changed.
+	bool add_codepoints(const std::vector<char32_t> &p_codepoints);
+
+	Vector2i get_slot_size() const { return slot_size; }
+	const PackedByteArray &get_pixels() const { return pixels; }
+	Vector2i get_image_size() const { return image_size; }
+	Ref<ImageTexture> get_texture();
+	uint64_t get_generation() const { return generation; }
+
+private:
+	NvimFontCache *fonts = nullptr;
+	uint64_t font_generation = 0;
+	int32_t font_size = 14;
+	float ascent = 12.0f;
+	Vector2i slot_size = Vector2i(8, 16);
+	Vector2i image_size;
+	PackedByteArray pixels;
+	std::unordered_map<char32_t, uint32_t> slots;
+	uint32_t next_slot = 1;
+	uint64_t generation = 0;
+	uint64_t uploaded_generation = 0;
+	Ref<Image> image;
+	Ref<ImageTexture> texture;
+
+	void _ensure_capacity(uint32_t p_slot);
+};
+
+} // namespace godot
+
+#endif // NVIM_GLYPH_ATLAS_H
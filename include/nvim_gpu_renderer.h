@@ -0,0 +1,61 @@
+#ifndef NVIM_GPU_RENDERER_H
+#define NVIM_GPU_RENDERER_H
+
+#include <godot_cpp/classes/image.hpp>
+#include <godot_cpp/classes/shader.hpp>
+#include <godot_cpp/classes/shader_material.hpp>
+#include <godot_cpp/variant/packed_byte_array.hpp>
+#include <godot_cpp/variant/rid.hpp>
+
+#include "nvim_glyph_atlas.h"
+#include "nvim_grid.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace godot {
+
+// Draws a grid as one quad per row. Each cell is three texels of an RGBA8 data texture
+// (glyph slot + attributes, foreground, background) that a canvas_item shader expands
+// using the glyph atlas. Every row owns a one-texel-high texture and a persistent Image,
+// so a frame uploads only the rows that changed.
+class NvimGpuRenderer {
+public:
+	NvimGpuRenderer() = default;
+	~NvimGpuRenderer();
+
+	void configure(NvimFontCache *p_fonts);
+	void draw(const RID &p_parent_item, NvimGrid &p_grid, const NvimPalette &p_palette);
+	void invalidate();
+	void release();
+
+private:
+	static constexpr int32_t TEXELS_PER_CELL = 3;
+
+	struct RowTexture {
+		Ref<Image> image;
+		RID texture;
+	};
+
+	NvimGlyphAtlas atlas;
+	RID canvas_item;
+	RID parent_item;
+	Ref<Shader> shader;
+	Ref<ShaderMaterial> material;
+	std::vector<RowTexture> row_textures;
+	PackedByteArray row_pixels;
+	int32_t columns = 0;
+	int32_t rows = 0;
+	Vector2 cell_size = Vector2(8, 16);
+	bool needs_full_upload = true;
+	bool quad_dirty = true;
+
+	void _ensure_canvas_item(const RID &p_parent_item);
+	void _free_row_textures();
+	void _write_row(const NvimGrid &p_grid, const NvimPalette &p_palette, int32_t p_row);
+	void _upload_row(int32_t p_row);
+};
+
+} // namespace godot
+
+#endif // NVIM_GPU_RENDERER_H
@@ -0,0 +1,119 @@
+#ifndef NVIM_GRID_H
+#define NVIM_GRID_H
+
+#include <godot_cpp/variant/color.hpp>
+#include <godot_cpp/variant/string.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace godot {
+
+// A blank cell holds " "; an empty text is the right half of the double-width character
+// in the cell before it, exactly as Neovim sends it in grid_line.
+struct NvimCell {
+	String text = " ";
+	int64_t hl_id = 0;
+};
+
+// A Neovim grid plus the set of rows that changed since a renderer last consumed them.
+struct NvimGrid {
+	int32_t columns = 0;
+	int32_t rows = 0;
+	std::vector<std::vector<NvimCell>> cells;
+	std::vector<uint8_t> dirty_rows;
+
+	static bool is_wide_cell(const std::vector<NvimCell> &p_row, size_t p_column) {
+		return p_column + 1 < p_row.size() && !p_row[p_column].text.is_empty() && p_row[p_column + 1].text.is_empty();
+	}
+
+	void mark_row_dirty(int64_t p_row) {
+		if (p_row < 0 || p_row >= rows) {
+			return;
+		}
+		if (dirty_rows.size() != static_cast<size_t>(rows)) {
+			dirty_rows.assign(static_cast<size_t>(rows), 1);
+			return;
+		}
+		dirty_rows[static_cast<size_t>(p_row)] = 1;
+	}
+
+	void mark_rows_dirty(int64_t p_top, int64_t p_bottom) {
+		int64_t top = std::max<int64_t>(p_top, 0);
+		int64_t bottom = std::min<int64_t>(p_bottom, rows);
+		for (int64_t row = top; row < bottom; ++row) {
+			mark_row_dirty(row);
+		}
+	}
+
+	void mark_all_dirty() {
+		dirty_rows.assign(static_cast<size_t>(std::max(rows, 0)), 1);
+	}
+
+	bool is_row_dirty(int32_t p_row) const {
+		if (p_row < 0 || static_cast<size_t>(p_row) >= dirty_rows.size()) {
+			return true;
+		}
+		return dirty_rows[static_cast<size_t>(p_row)] != 0;
+	}
+
+	void clear_dirty() {
+		dirty_rows.assign(static_cast<size_t>(std::max(rows, 0)), 0);
+	}
+};
+
+enum NvimHighlightAttribute : uint32_t {
+	NVIM_HL_UNDERLINE = 1 << 0,
+	NVIM_HL_UNDERCURL = 1 << 1,
+	NVIM_HL_STRIKETHROUGH = 1 << 2,
+};
+
+// Where a window grid sits on the default grid when ext_multigrid is attached.
+struct NvimGridPlacement {
+	int32_t row = 0;
+	int32_t column = 0;
+	int32_t zindex = 0;
+	bool floating = false;
+	bool visible = true;
+};
+
+struct NvimHighlight {
+	Color foreground = Color(1, 1, 1, 1);
+	Color background = Color(0, 0, 0, 1);
+	bool has_foreground = false;
+	bool has_background = false;
+	uint32_t attributes = 0;
+};
+
+struct NvimPalette {
+	std::unordered_map<int64_t, NvimHighlight> highlights;
+	Color default_foreground = Color(1, 1, 1, 1);
+	Color default_background = Color(0, 0, 0, 1);
+
+	Color resolve_foreground(int64_t p_hl_id) const {
+		auto it = highlights.find(p_hl_id);
+		if (it != highlights.end() && it->second.has_foreground) {
+			return it->second.foreground;
+		}
+		return default_foreground;
+	}
+
+	Color resolve_background(int64_t p_hl_id) const {
+		auto it = highlights.find(p_hl_id);
+		if (it != highlights.end() && it->second.has_background) {
+			return it->second.background;
+		}
+		return default_background;
+	}
+
+	uint32_t resolve_attributes(int64_t p_hl_id) const {
+		auto it = highlights.find(p_hl_id);
+		return it != highlights.end() ? it->second.attributes : 0;
+	}
+};
+
+} // namespace godot
+
+#endif // NVIM_GRID_H
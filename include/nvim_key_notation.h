@@ -0,0 +1,35 @@
+#ifndef NVIM_KEY_NOTATION_H
+#define NVIM_KEY_NOTATION_H
+
+#include <godot_cpp/classes/global_constants.hpp>
+
+#include <cstdint>
+#include <string>
+
+namespace godot {
+
+// Translates Godot key events into Neovim key notation, appended as UTF-8 to the outbound
+// nvim_input buffer. Special keys and ASCII characters come from tables built at compile
+// time for every modifier combination, so the common path neither allocates nor formats.
+class NvimKeyNotation {
+public:
+	// Modifier bits, in the order Neovim writes them: <C-S-A-...>.
+	static constexpr uint8_t MOD_CTRL = 1;
+	static constexpr uint8_t MOD_SHIFT = 2;
+	static constexpr uint8_t MOD_ALT = 4;
+	static constexpr uint8_t MOD_COMBINATIONS = 8;
+
+	static constexpr uint8_t modifiers(bool p_shift, bool p_ctrl, bool p_alt) {
+		return (p_ctrl ? MOD_CTRL : 0) | (p_shift ? MOD_SHIFT : 0) | (p_alt ? MOD_ALT : 0);
+	}
+
+	// Appends the notation for a key event and returns true, or returns false without
+	// touching r_out when the key has no Neovim equivalent (e.g. a lone modifier).
+	static bool append_key(std::string &r_out, Key p_keycode, char32_t p_unicode, uint8_t p_modifiers);
+	// Appends <mods-name>, for keys outside the tables such as ScrollWheelUp.
+	static void append_named(std::string &r_out, const char *p_name, uint8_t p_modifiers);
+};
+
+} // namespace godot
+
+#endif // NVIM_KEY_NOTATION_H
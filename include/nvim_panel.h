@@ -12,17 +12,34 @@
 #include <godot_cpp/classes/input_event_key.hpp>
 #include <godot_cpp/classes/input_event_mouse_button.hpp>
 #include <godot_cpp/classes/input_event_mouse_motion.hpp>
+#include <godot_cpp/classes/input_event_pan_gesture.hpp>
 #include <godot_cpp/classes/v_box_container.hpp>
 #include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/variant/array.hpp>
+#include <godot_cpp/variant/callable.hpp>
 #include <godot_cpp/variant/color.hpp>
+#include <godot_cpp/variant/dictionary.hpp>
 #include <godot_cpp/variant/packed_string_array.hpp>
 #include <godot_cpp/variant/string.hpp>
 
 #include "nvim_client.h"
+#include "nvim_cursor_overlay.h"
+#include "nvim_font_cache.h"
+#include "nvim_gpu_renderer.h"
+#include "nvim_grid.h"
+#include "nvim_predictive_echo.h"
+#include "nvim_request.h"
+#include "nvim_row_renderer.h"
+#include "nvim_row_texture_cache.h"
+#include "nvim_rpc_reader.h"
+#include "nvim_rpc_requests.h"
+#include "nvim_rpc_writer.h"
 #include "mpack.h"
 
 #include <cstdint>
+#include <functional>
 #include <memory>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
@@ -51,70 +68,203 @@ class NvimPanel : public Control {
 private:
 	friend class NvimGridCanvas;
 
-	struct NvimCell {
-		String text = " ";
-		int64_t hl_id = 0;
-	};
-
-	struct NvimGrid {
-		int32_t columns = 0;
-		int32_t rows = 0;
-		std::vector<std::vector<NvimCell>> cells;
-	};
-
-	struct Highlight {
-		Color foreground = Color(1, 1, 1, 1);
-		Color background = Color(0, 0, 0, 1);
-		bool has_foreground = false;
-		bool has_background = false;
-	};
-
 	int64_t nvim_pid = -1;
 	VBoxContainer *root = nullptr;
 	String nvim_command = "nvim";
 
 	std::unique_ptr<NvimClient> nvim_client;
 	std::vector<uint8_t> stdout_buffer;
-	uint32_t next_request_id = 1;
+	// With decode_thread enabled, stdout is read and decoded off the main thread.
+	NvimRpcReader rpc_reader;
+	std::vector<std::unique_ptr<NvimRpcMessage>> decoded_messages;
+	bool decode_thread_setting = false;
+	// Outbound messages are queued during the frame and written together from _process.
+	NvimRpcWriter rpc_writer;
+	// Requests awaiting a response; input, mouse and resize go out as notifications instead.
+	NvimRpcRequests rpc_requests;
+	// Batched calls get their request id and table entry when queued, so they can be
+	// cancelled or awaited before the batch goes out.
+	struct BatchCall {
+		String method;
+		Array args;
+		uint32_t request_id = 0;
+	};
+	int32_t batch_depth = 0;
+	std::vector<BatchCall> batch_calls;
+	int64_t batches_sent = 0;
+	int64_t batched_calls_sent = 0;
+	// Handlers for requests from Neovim, keyed by method name. A handler fills r_error to fail.
+	using RequestHandler = std::function<Variant(const mpack_node_t &p_params, String &r_error)>;
+	std::unordered_map<std::string, RequestHandler> request_handlers;
+	int64_t nvim_requests_answered = 0;
+	int64_t nvim_requests_unknown = 0;
+	// Clipboard provider state; the last yank remembers its register type for the next put.
+	bool clipboard_provider_setting = true;
+	bool clipboard_provider_requested = false;
+	String clipboard_last_text;
+	String clipboard_last_regtype = "v";
+	int64_t clipboard_gets = 0;
+	int64_t clipboard_sets = 0;
+	// Paste being streamed through nvim_paste; paste_offset is the next byte to send.
+	std::string paste_data;
+	size_t paste_offset = 0;
+	bool paste_active = false;
+	bool paste_started = false;
+	int32_t paste_chunks_in_flight = 0;
+	uint32_t paste_generation = 0;
+	int64_t pastes_started = 0;
+	int64_t paste_bytes_sent = 0;
+	// Wheel and pan deltas summed over the frame, in wheel steps, with the modifiers and
+	// position of the latest event; and the cell of the last press or drag sent.
+	bool wheel_pending = false;
+	double wheel_delta_x = 0.0;
+	double wheel_delta_y = 0.0;
+	String wheel_modifiers;
+	bool wheel_shift = false;
+	bool wheel_ctrl = false;
+	bool wheel_alt = false;
+	Vector2 wheel_position;
+	String drag_button;
+	int64_t drag_grid_id = 0;
+	int64_t drag_row = -1;
+	int64_t drag_column = -1;
+	int64_t mouse_events_received = 0;
+	// Events count each wheel step; messages count the RPC calls that carried them.
+	int64_t mouse_events_sent = 0;
+	int64_t mouse_messages_sent = 0;
+	// Keys pressed during a frame, sent as a single nvim_input; flushed early before any
+	// other input so mouse events and commands keep their order relative to typing.
+	std::string pending_keys;
+	uint64_t pending_keys_usec = 0;
+	uint64_t pending_keys_frame = 0;
+	int64_t key_inputs_queued = 0;
+	int64_t key_input_calls_sent = 0;
+	// Time from a key press to the redraw that answers it: the first flush of a grid-changing
+	// batch that Neovim started after the keys were written.
+	uint64_t input_echo_start_usec = 0;
+	uint64_t input_echo_start_frame = 0;
+	bool input_echo_unsent = false;
+	bool input_echo_skip_batch = false;
+	bool redraw_batch_open = false;
+	bool redraw_batch_touched_grid = false;
+	int64_t last_input_echo_usec = -1;
+	int64_t input_echo_total_usec = 0;
+	int64_t input_echo_total_frames = 0;
+	int64_t input_echo_samples = 0;
+	// Bounded wait for Neovim's echo after keys are sent (echo_wait_ms; 0 disables it). The
+	// wait is answered by the same kind of flush as input_echo: one ending a grid-changing
+	// batch that Neovim started after the keys were written.
+	uint64_t echo_wait_usec = 0;
+	bool echo_wait_armed = false;
+	bool echo_wait_skip_batch = false;
+	bool echo_wait_answered = true;
+	int64_t echo_waits = 0;
+	int64_t echo_wait_hits = 0;
+	int64_t echo_wait_total_usec = 0;
 	int32_t grid_columns = 80;
 	int32_t grid_rows = 24;
 	std::unordered_map<int64_t, NvimGrid> grids;
 	int64_t current_grid_id = 0;
 	int64_t cursor_row = 0;
 	int64_t cursor_column = 0;
-	std::unordered_map<int64_t, Highlight> highlight_definitions;
-	Color default_foreground = Color(1, 1, 1, 1);
-	Color default_background = Color(0, 0, 0, 1);
+	NvimCursorOverlay cursor_overlay;
+	// Opt-in local echo of characters typed in insert mode; nvim_mode_name is the name
+	// from the last mode_change.
+	bool predictive_echo_setting = false;
+	NvimPredictiveEcho predictive_echo;
+	String nvim_mode_name;
+	NvimPalette palette;
 	NvimGridCanvas *grid_canvas = nullptr;
 	int32_t font_size = 14;
-	mutable Ref<Font> cached_font;
+	NvimFontCache font_cache;
 	CenterContainer *status_overlay = nullptr;
 	Label *status_label = nullptr;
 	Button *status_button = nullptr;
 	bool autostart = true;
 	bool nvim_crashed = false;
 	String font_path_setting;
+	PackedStringArray fallback_fonts_setting;
 	PackedStringArray extra_args_setting;
 	String theme_name_setting = "default";
 	Color theme_default_foreground = Color(1, 1, 1, 1);
 	Color theme_default_background = Color(0, 0, 0, 1);
 	String theme_colorscheme_name;
 	bool debug_logging_enabled = false;
+	String renderer_setting = "canvas";
+	std::unique_ptr<NvimGpuRenderer> gpu_renderer;
+	std::unordered_map<int64_t, std::unique_ptr<NvimRowRenderer>> row_renderers;
+	std::unique_ptr<NvimRowTextureCache> row_texture_cache;
+	int64_t row_texture_cache_limit = 0;
+	int32_t row_prepare_tasks = 0;
+	int64_t last_drawn_grid_id = -1;
+	double smooth_scroll_time = 0.0;
+	bool multigrid_attached = false;
+	std::unordered_map<int64_t, NvimGridPlacement> grid_placements;
+	std::unordered_map<int64_t, int64_t> grid_toplines;
+	// The UI is detached while the panel is hidden; Neovim keeps running without a screen.
+	bool ui_attached = false;
+	// start_nvim() waits for the canvas layout to settle so the first attach already has
+	// the right size; the measurement must repeat on two frames before it is trusted.
+	bool attach_pending = false;
+	int32_t attach_probe_columns = 0;
+	int32_t attach_probe_rows = 0;
+	uint64_t nvim_start_usec = 0;
+	bool awaiting_first_frame = false;
+	bool first_frame_flushed = false;
+	int64_t time_to_first_frame_usec = -1;
+	bool in_background = false;
+	uint64_t last_background_poll_usec = 0;
+	// Canvas size changes are coalesced and sent from _process at most once per interval.
+	bool resize_pending = false;
+	uint64_t resize_interval_usec = 50000;
+	uint64_t last_resize_sent_usec = 0;
+	int64_t resize_requests_sent = 0;
+	int64_t resize_events_coalesced = 0;
+	bool redraw_pending = false;
+	uint64_t frame_interval_usec = 0;
+	uint64_t next_frame_present_usec = 0;
+	uint64_t frame_stats_window_start_usec = 0;
+	int64_t frames_presented_window = 0;
+	int64_t frames_coalesced_window = 0;
+	int64_t frames_presented_per_second = 0;
+	int64_t frames_coalesced_per_second = 0;
 
 
 	void _ensure_ui_created();
 	void _update_ui_state();
 	void _poll_nvim();
 	bool _try_process_message();
+	void _apply_decoded_messages();
+	bool _dispatch_message(const mpack_node_t &p_root);
 	void _send_ui_attach();
+	bool _send_ui_detach();
+	bool _send_ui_set_focus(bool p_focused);
+	void _set_background(bool p_background);
+	void _reattach_ui();
+	void _attach_when_laid_out();
+	bool _compute_canvas_grid_size(int32_t &r_columns, int32_t &r_rows);
 	void _handle_redraw(const mpack_node_t &p_batches_node);
 	void _handle_redraw_event(const String &p_event_name, const mpack_node_t &p_args_node);
 	void _handle_grid_resize(const mpack_node_t &p_args_node);
 	void _handle_grid_clear(const mpack_node_t &p_args_node);
 	void _handle_grid_destroy(const mpack_node_t &p_args_node);
 	void _handle_grid_line(const mpack_node_t &p_args_node);
+	// Writes grid_line cells into r_row from p_column; returns the column after the last one.
+	static int64_t _write_grid_line_cells(std::vector<NvimCell> &r_row, int64_t p_column, const mpack_node_t &p_cells_node);
 	void _handle_grid_cursor_goto(const mpack_node_t &p_args_node);
 	void _handle_grid_scroll(const mpack_node_t &p_args_node);
+	void _handle_mode_info_set(const mpack_node_t &p_args_node);
+	void _handle_mode_change(const mpack_node_t &p_args_node);
+	void _update_cursor();
+	const NvimGrid *_get_shown_grid(int64_t p_grid_id, Vector2 &r_origin) const;
+	void _predict_key(char32_t p_unicode, uint8_t p_modifiers);
+	void _reconcile_predictive_echo();
+	void _update_predictive_echo();
+	void _handle_win_pos(const mpack_node_t &p_args_node);
+	void _handle_win_float_pos(const mpack_node_t &p_args_node);
+	void _handle_msg_set_pos(const mpack_node_t &p_args_node);
+	void _handle_win_hide(const mpack_node_t &p_args_node, bool p_close);
+	void _handle_win_viewport(const mpack_node_t &p_args_node);
 	NvimGrid &_ensure_grid(int64_t p_grid_id, int32_t p_columns, int32_t p_rows);
 	void _fill_row(std::vector<NvimCell> &p_row);
 	void _handle_hl_attr_define(const mpack_node_t &p_args_node);
@@ -122,12 +272,40 @@ private:
 	Color _color_from_rgb_value(int64_t p_value) const;
 	Color _resolve_foreground(int64_t p_hl_id) const;
 	Color _resolve_background(int64_t p_hl_id) const;
-	Ref<Font> _obtain_font() const;
-	int32_t _obtain_font_size() const;
 	void _draw_grid(NvimGridCanvas *p_canvas);
+	void _draw_multigrid(NvimGridCanvas *p_canvas);
+	void _draw_grid_rows(NvimGridCanvas *p_canvas, int64_t p_grid_id, NvimGrid &p_grid, const Vector2 &p_origin, int32_t p_draw_index);
+	void _configure_row_texture_cache();
+	void _release_row_renderers(int64_t p_keep_grid_id);
+	bool _get_grid_placement(int64_t p_grid_id, Vector2 &r_origin, int32_t &r_draw_index) const;
+	bool _find_grid_at(int64_t p_row, int64_t p_column, int64_t &r_grid_id, int64_t &r_row, int64_t &r_column) const;
+	int64_t _get_main_grid_id() const;
+	int64_t _get_drawn_grid_id() const;
+	void _mark_all_grids_dirty();
 	void _update_canvas_size();
 	void _request_grid_redraw();
+	void _present_pending_frame();
+	uint64_t _compute_frame_interval_usec(int32_t p_max_fps) const;
 	bool _send_nvim_input(const String &p_keys);
+	bool _queue_key_event(Key p_keycode, char32_t p_unicode, uint8_t p_modifiers);
+	void _begin_key_input();
+	bool _flush_pending_keys();
+	void _wait_for_echo();
+	void _track_request(uint32_t p_request_id, NvimRpcRequests::Callback p_callback);
+	bool _queue_call(const String &p_method, const Array &p_args, NvimRpcRequests::Callback p_callback, uint32_t *r_request_id = nullptr);
+	bool _send_batch();
+	void _abort_batch();
+	void _handle_nvim_request(const mpack_node_t &p_root);
+	void _on_request_handler_completed(const Variant &p_result, int64_t p_msgid, int64_t p_start_usec);
+	static bool _take_handler_error(Variant &r_result, String &r_error);
+	void _respond(uint32_t p_msgid, const String &p_error, const Variant &p_result);
+	void _register_clipboard_handlers();
+	void _install_clipboard_provider();
+	bool _start_paste(const String &p_text);
+	void _pump_paste();
+	// p_end_stream sends the closing phase 3 for a stream Neovim still has open.
+	void _cancel_paste(bool p_end_stream = false);
+	static String _format_rpc_error(const mpack_node_t &p_error);
 	bool _send_nvim_command(const String &p_command);
 	bool _send_nvim_input_mouse(const String &p_button, const String &p_action, const String &p_modifiers, int64_t p_grid, int64_t p_row, int64_t p_column);
 	String _build_modifier_string(bool p_shift, bool p_ctrl, bool p_alt) const;
@@ -135,12 +313,16 @@ private:
 	bool _handle_key_event(const Ref<InputEventKey> &p_key_event);
 	bool _handle_mouse_button_event(const Ref<InputEventMouseButton> &p_mouse_event);
 	bool _handle_mouse_motion_event(const Ref<InputEventMouseMotion> &p_motion_event);
-	String _translate_key_event(const Ref<InputEventKey> &p_key_event) const;
-	String _format_special_key(const String &p_key_name, bool p_shift, bool p_ctrl, bool p_alt) const;
+	void _queue_wheel(double p_delta_x, double p_delta_y, const Vector2 &p_position, bool p_shift, bool p_ctrl, bool p_alt);
+	void _flush_pending_wheel();
+	void _reset_mouse_coalescing();
 	void _convert_position_to_cell(const Vector2 &p_position, int64_t &r_row, int64_t &r_column) const;
 	void _sync_neovim_size_to_canvas();
+	void _flush_pending_resize();
+	void _flush_outbound();
 	bool _send_ui_try_resize(int32_t p_columns, int32_t p_rows);
 	void _on_canvas_resized();
+	void _refresh_fonts();
 	void _ensure_cell_metrics();
 	String _get_default_font_path() const;
 	void _on_status_button_pressed();
@@ -157,6 +339,7 @@ private:
 
 protected:
 	static void _bind_methods();
+	void _notification(int32_t p_what);
 
 public:
 	NvimPanel();
@@ -174,8 +357,40 @@ public:
 	void stop_nvim();
 	bool send_input(const String &p_keys);
 	bool send_command(const String &p_command);
-	bool open_file_in_nvim(const String &p_path);
+	// A positive p_line also moves the cursor there (1-based line, 0-based byte column).
+	bool open_file_in_nvim(const String &p_path, int64_t p_line = 0, int64_t p_column = 0);
 	void reload_settings();
+	// Sends an arbitrary API request; the returned object emits completed(result) or failed(error).
+	Ref<NvimRequest> request(const String &p_method, const Array &p_args);
+	bool cancel_request(int64_t p_id);
+	// Calls made between begin_batch() and the matching end_batch() (commands, request())
+	// are sent as one nvim_call_atomic; each still gets its own result. Batches nest.
+	void begin_batch();
+	bool end_batch();
+	// Answers rpcrequest(ui_channel, method, ...) from Neovim. The handler receives the
+	// arguments as an Array and its return value becomes the result. Unknown methods are
+	// answered with an error, so a request from Neovim never waits forever.
+	void register_request_handler(const String &p_method, const Callable &p_handler);
+	void unregister_request_handler(const String &p_method);
+
+	class BatchScope {
+	public:
+		explicit BatchScope(NvimPanel *p_panel) :
+				panel(p_panel) { panel->begin_batch(); }
+		~BatchScope() { panel->end_batch(); }
+		BatchScope(const BatchScope &) = delete;
+		BatchScope &operator=(const BatchScope &) = delete;
+
+	private:
+		NvimPanel *panel;
+	};
+	Dictionary get_stats() const;
+#ifdef DEBUG_ENABLED
+	Dictionary benchmark_row_prepare(int32_t p_iterations);
+	Dictionary benchmark_key_translation(int32_t p_iterations);
+	// Feeds a CJK grid_line through the cell decoder and glyph atlas; false if it would be clipped.
+	bool check_wide_glyphs();
+#endif
 };
 
 } // namespace godot
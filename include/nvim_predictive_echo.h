@@ -0,0 +1,87 @@
+#ifndef NVIM_PREDICTIVE_ECHO_H
+#define NVIM_PREDICTIVE_ECHO_H
+
+#include <godot_cpp/variant/rid.hpp>
+#include <godot_cpp/variant/string.hpp>
+#include <godot_cpp/variant/vector2.hpp>
+
+#include "nvim_cursor_overlay.h"
+#include "nvim_font_cache.h"
+#include "nvim_grid.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace godot {
+
+// Mosh-style local echo. Characters typed in insert mode are drawn at the cursor on their
+// own canvas item as soon as the key is pressed, with the rest of the line shifted right to
+// make room, and checked against the grid whenever Neovim flushes: a prediction whose cell
+// Neovim has rewritten since the key was pressed, and which now shows it, is dropped as
+// confirmed; one still unconfirmed after CONFIRM_TIMEOUT_USEC is rolled back together with
+// everything after it.
+class NvimPredictiveEcho {
+public:
+	// Above every grid layer, below the cursor.
+	static constexpr int32_t DRAW_INDEX = NvimCursorOverlay::DRAW_INDEX - 1;
+	// Neovim may flush for other reasons before it has read the key, so a missing character
+	// is only treated as a misprediction once it is this old.
+	static constexpr uint64_t CONFIRM_TIMEOUT_USEC = 150000;
+
+	NvimPredictiveEcho() = default;
+	~NvimPredictiveEcho();
+
+	// Predicts p_char after the last prediction, or at the cursor when there is none. Returns
+	// false when it would leave the row or a key that cannot be predicted is still unconfirmed.
+	bool predict(int64_t p_grid_id, int64_t p_row, int64_t p_cursor_column, int32_t p_grid_columns, char32_t p_char, uint64_t p_now_usec);
+	// A key that cannot be predicted (Backspace, arrows, chords) was sent; the next flush
+	// rolls everything back and nothing is predicted before it.
+	void invalidate() { invalidated = true; }
+	// Records that Neovim rewrote [p_column_start, p_column_end) of a row at p_now_usec. Only a
+	// rewrite after the key was pressed can confirm a prediction; a cell that already held
+	// the same character proves nothing.
+	void note_cells_updated(int64_t p_grid_id, int64_t p_row, int64_t p_column_start, int64_t p_column_end, uint64_t p_now_usec);
+	// Checks the predictions against p_grid on flush; returns true if any were dropped.
+	bool reconcile(const NvimGrid *p_grid, int64_t p_grid_id, int64_t p_cursor_row, uint64_t p_now_usec);
+	// Drops every prediction, e.g. when Neovim leaves insert mode; returns true if any existed.
+	bool rollback();
+
+	bool has_predictions() const { return !predictions.empty(); }
+	int64_t get_grid_id() const { return grid_id; }
+	int64_t get_row() const { return row; }
+	// Where the cursor is shown while predictions are pending: right after the last one.
+	int64_t get_cursor_column() const;
+
+	// Re-records the item; p_grid is the grid the predictions are on, or null to hide them.
+	void update(const RID &p_parent_item, NvimFontCache *p_fonts, const NvimGrid *p_grid, const NvimPalette &p_palette, const Vector2 &p_grid_origin);
+	// Frees the item and forgets all predictions without counting them as rolled back.
+	void release();
+
+	uint64_t get_predicted() const { return predicted; }
+	uint64_t get_confirmed() const { return confirmed; }
+	uint64_t get_rolled_back() const { return rolled_back; }
+
+private:
+	struct Prediction {
+		int64_t column = 0;
+		String text;
+		uint64_t usec = 0;
+		bool updated = false;
+	};
+
+	std::vector<Prediction> predictions;
+	int64_t grid_id = 0;
+	int64_t row = 0;
+	bool invalidated = false;
+
+	RID item;
+	RID parent_item;
+
+	uint64_t predicted = 0;
+	uint64_t confirmed = 0;
+	uint64_t rolled_back = 0;
+};
+
+} // namespace godot
+
+#endif // NVIM_PREDICTIVE_ECHO_H
@@ -0,0 +1,47 @@
+#ifndef NVIM_REQUEST_H
+#define NVIM_REQUEST_H
+
+#include <godot_cpp/classes/ref_counted.hpp>
+#include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/variant/string.hpp>
+#include <godot_cpp/variant/variant.hpp>
+
+#include <cstdint>
+
+namespace godot {
+
+// Handle for one NvimPanel.request() call. Emits completed(result) or failed(error) once;
+// many may be in flight together, so `await panel.request(...).completed` pipelines.
+class NvimRequest : public RefCounted {
+	GDCLASS(NvimRequest, RefCounted);
+
+private:
+	uint64_t panel_id = 0;
+	int64_t id = 0;
+	String method;
+	bool done = false;
+	bool succeeded = false;
+	Variant result;
+	String error;
+
+protected:
+	static void _bind_methods();
+
+public:
+	void setup(uint64_t p_panel_id, int64_t p_id, const String &p_method);
+	void finish(const Variant &p_result);
+	void fail(const String &p_error);
+
+	int64_t get_id() const { return id; }
+	String get_method() const { return method; }
+	bool is_done() const { return done; }
+	bool is_succeeded() const { return succeeded; }
+	Variant get_result() const { return result; }
+	String get_error() const { return error; }
+	// Stops waiting; the response is dropped and neither signal is emitted.
+	void cancel();
+};
+
+} // namespace godot
+
+#endif // NVIM_REQUEST_H
@@ -0,0 +1,143 @@
+#ifndef NVIM_ROW_RENDERER_H
+#define NVIM_ROW_RENDERER_H
+
+#include <godot_cpp/classes/font.hpp>
+#include <godot_cpp/classes/image_texture.hpp>
+#include <godot_cpp/variant/rect2.hpp>
+#include <godot_cpp/variant/rid.hpp>
+
+#include "nvim_font_cache.h"
+#include "nvim_grid.h"
+#include "nvim_row_shaper.h"
+#include "nvim_row_texture_cache.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace godot {
+
+// Gives every grid row its own RenderingServer canvas item under a per-grid root item.
+// A row's draw list is only cleared and re-recorded when that row is dirty, and
+// scrolls move existing row items to new y positions instead of re-recording them.
+// When many rows are dirty, their draw data is prepared on WorkerThreadPool and only the
+// RenderingServer submission stays on the main thread.
+class NvimRowRenderer {
+public:
+	// Fewer dirty rows than this are prepared inline; the pool round trip would cost more.
+	static constexpr size_t PARALLEL_PREPARE_MIN_ROWS = 16;
+
+	NvimRowRenderer() = default;
+	~NvimRowRenderer();
+
+	void configure(NvimFontCache *p_fonts);
+	void draw(const RID &p_parent_item, NvimGrid &p_grid, const NvimPalette &p_palette);
+	// Reassigns row items for a full-width grid_scroll; returns false if the caller must redraw the region.
+	// Items are only moved on the next draw, so a frame in between still shows the old rows.
+	bool scroll(int32_t p_top, int32_t p_bottom, int32_t p_rows);
+	void invalidate();
+	void release();
+	// Optional; rows found in the cache are drawn as one texture blit.
+	void set_texture_cache(NvimRowTextureCache *p_cache);
+	// Positions the grid under the parent; used for split and floating windows with ext_multigrid.
+	void set_placement(const Vector2 &p_origin, int32_t p_draw_index, bool p_visible);
+
+	// With smooth scrolling, rows that scroll out are kept as ghost items so that a
+	// following animate_pending_scroll() can slide old and new rows by pixel offsets.
+	void set_smooth_scroll(bool p_enabled);
+	// Starts or extends a slide for the rows translated since the last draw.
+	bool animate_pending_scroll(double p_duration);
+	// Advances the slide with transform updates only; returns true while it is running.
+	bool process_scroll_animation(double p_delta);
+	bool is_scroll_animating() const { return scroll_animating; }
+	// Pixel offset the slide currently applies to a row, so overlays can follow it.
+	float get_row_offset(int32_t p_row) const;
+
+	// 1 prepares rows on the calling thread; 0 lets the pool use one task per worker thread.
+	void set_prepare_tasks(int32_t p_tasks) { prepare_tasks = p_tasks; }
+	// Builds background runs, colors, decorations and row text for p_rows without touching
+	// the RenderingServer or TextServer, split over p_tasks pool tasks.
+	void prepare_rows(const NvimGrid &p_grid, const NvimPalette &p_palette, const std::vector<int32_t> &p_rows, int32_t p_tasks);
+
+	uint64_t get_rows_recorded() const { return rows_recorded; }
+	const NvimRowShaper &get_shaper() const { return shaper; }
+
+private:
+	struct PreparedRow {
+		int32_t row = 0;
+		// Background runs that differ from the default background.
+		std::vector<Rect2> background_rects;
+		std::vector<Color> background_colors;
+		// Foreground per column, for glyphs.
+		std::vector<Color> foregrounds;
+		// Underline and strikethrough segments as point pairs.
+		std::vector<Vector2> line_points;
+		std::vector<Color> line_colors;
+		NvimRowShaper::RowText text;
+	};
+
+	struct PrepareJob {
+		NvimRowRenderer *renderer = nullptr;
+		const NvimGrid *grid = nullptr;
+		const NvimPalette *palette = nullptr;
+		const std::vector<int32_t> *rows = nullptr;
+	};
+
+	struct Ghost {
+		RID item;
+		Ref<ImageTexture> texture;
+		// Row the ghost's content maps to after the scroll; always outside the scroll region.
+		int32_t row = 0;
+	};
+
+	RID root_item;
+	std::vector<RID> row_items;
+	// Keeps blitted textures alive while a row item still references them, even after eviction.
+	std::vector<Ref<ImageTexture>> row_textures;
+	NvimRowTextureCache *texture_cache = nullptr;
+	NvimRowShaper shaper;
+	RID parent_item;
+	Ref<Font> font;
+	int32_t font_size = 14;
+	Vector2 cell_size = Vector2(8, 16);
+	float ascent = 12.0f;
+	int32_t columns = 0;
+	bool needs_full_redraw = true;
+	bool needs_placement = false;
+	uint64_t rows_recorded = 0;
+	int32_t prepare_tasks = 0;
+	// Reused between draws so prepared rows keep their capacity.
+	std::vector<PreparedRow> prepared_rows;
+	std::vector<int32_t> dirty_row_list;
+
+	Vector2 origin;
+	int32_t draw_index = 0;
+	bool visible = true;
+
+	bool smooth_scroll = false;
+	RID scroll_clip_item;
+	std::vector<Ghost> ghosts;
+	int32_t scroll_top = 0;
+	int32_t scroll_bottom = 0;
+	int32_t pending_scroll_rows = 0;
+	bool scroll_animating = false;
+	float scroll_offset = 0.0f;
+	float scroll_start_offset = 0.0f;
+	double scroll_elapsed = 0.0;
+	double scroll_duration = 0.0;
+
+	void _resize(const RID &p_parent_item, int32_t p_columns, int32_t p_rows);
+	void _place_row(int32_t p_row);
+	void _place_all();
+	void _update_root();
+	bool _record_cached_row(int32_t p_row, const std::vector<NvimCell> &p_cells, const NvimPalette &p_palette);
+	void _record_row(PreparedRow &p_prepared);
+	void _prepare_row(PreparedRow &r_prepared, const std::vector<NvimCell> &p_cells, int32_t p_columns, const NvimPalette &p_palette) const;
+	static void _prepare_row_task(void *p_userdata, uint32_t p_index);
+	void _finish_scroll_animation();
+	void _drop_ghosts();
+	bool _in_scroll_region(int32_t p_row) const;
+};
+
+} // namespace godot
+
+#endif // NVIM_ROW_RENDERER_H
@@ -0,0 +1,76 @@
+#ifndef NVIM_ROW_SHAPER_H
+#define NVIM_ROW_SHAPER_H
+
+#include <godot_cpp/classes/font.hpp>
+#include <godot_cpp/variant/rid.hpp>
+#include <godot_cpp/variant/vector2.hpp>
+
+#include "nvim_grid.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace godot {
+
+// Keeps one TextServer shaped-text RID per grid row together with the glyph buffer
+// extracted from it. A row is only reshaped when its text changes or the font does,
+// so recording a row for a highlight change just replays the cached glyphs.
+class NvimRowShaper {
+public:
+	struct Glyph {
+		RID font_rid;
+		int64_t index = 0;
+		int32_t column = 0;
+		// Pen position relative to the row origin, before the baseline is applied.
+		Vector2 position;
+	};
+
+	// A row's characters, the column each one belongs to and a hash of both. Building it
+	// does not touch the TextServer, so rows can be prepared on worker threads.
+	struct RowText {
+		std::vector<char32_t> characters;
+		std::vector<int32_t> column_of_char;
+		uint64_t hash = 0;
+	};
+
+	NvimRowShaper() = default;
+	~NvimRowShaper();
+
+	void configure(const Ref<Font> &p_font, int32_t p_font_size, float p_cell_width);
+	void resize(int32_t p_rows);
+	void scroll(int32_t p_top, int32_t p_bottom, int32_t p_rows);
+	void clear();
+
+	static void build_text(const std::vector<NvimCell> &p_cells, int32_t p_columns, RowText &r_text);
+	const std::vector<Glyph> &shape(int32_t p_row, const std::vector<NvimCell> &p_cells, int32_t p_columns);
+	// Main thread only; p_text comes from build_text and is left unchanged.
+	const std::vector<Glyph> &shape_text(int32_t p_row, RowText &p_text);
+
+	uint64_t get_rows_shaped() const { return rows_shaped; }
+	uint64_t get_rows_reused() const { return rows_reused; }
+
+private:
+	struct ShapedRow {
+		RID shaped_text;
+		uint64_t text_hash = 0;
+		// The text the glyphs were shaped from, compared in full when the hash matches.
+		std::vector<char32_t> characters;
+		std::vector<int32_t> column_of_char;
+		bool valid = false;
+		std::vector<Glyph> glyphs;
+	};
+
+	Ref<Font> font;
+	int32_t font_size = 14;
+	float cell_width = 8.0f;
+	std::vector<ShapedRow> rows;
+	RowText scratch_text;
+	uint64_t rows_shaped = 0;
+	uint64_t rows_reused = 0;
+
+	void _free_row(ShapedRow &p_row);
+};
+
+} // namespace godot
+
+#endif // NVIM_ROW_SHAPER_H
@@ -0,0 +1,61 @@
+#ifndef NVIM_ROW_TEXTURE_CACHE_H
+#define NVIM_ROW_TEXTURE_CACHE_H
+
+#include <godot_cpp/classes/image_texture.hpp>
+
+#include "nvim_glyph_atlas.h"
+#include "nvim_grid.h"
+
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+namespace godot {
+
+// LRU cache of fully rasterized rows keyed by their cells and resolved colors. Lookups go
+// through a hash of the key, and a hit is only taken when the stored key matches in full.
+// Blank `~` lines, statuslines and rows moving during scrolls repeat often, and a hit
+// replaces the row's rects and glyph draws with a single texture blit.
+class NvimRowTextureCache {
+public:
+	void configure(NvimFontCache *p_fonts);
+	void set_memory_limit(int64_t p_bytes);
+	int64_t get_memory_limit() const { return memory_limit; }
+	void clear();
+
+	// Returns the cached texture for the row, rasterizing it on a miss.
+	Ref<ImageTexture> acquire(const std::vector<NvimCell> &p_cells, int32_t p_columns, const NvimPalette &p_palette);
+
+	uint64_t get_hits() const { return hits; }
+	uint64_t get_misses() const { return misses; }
+	int64_t get_memory_used() const { return memory_used; }
+	size_t get_entry_count() const { return entries.size(); }
+
+private:
+	struct Entry {
+		uint64_t key = 0;
+		std::vector<uint32_t> words;
+		Ref<ImageTexture> texture;
+		int64_t bytes = 0;
+	};
+
+	NvimGlyphAtlas atlas;
+	Vector2 cell_size = Vector2(8, 16);
+	int64_t memory_limit = 0;
+	int64_t memory_used = 0;
+	uint64_t hits = 0;
+	uint64_t misses = 0;
+	std::list<Entry> entries;
+	std::unordered_map<uint64_t, std::list<Entry>::iterator> lookup;
+	std::vector<uint32_t> key_words;
+
+	// Serializes the row into key_words and returns their hash.
+	uint64_t _build_key(const std::vector<NvimCell> &p_cells, int32_t p_columns, const NvimPalette &p_palette);
+	Ref<ImageTexture> _rasterize_row(const std::vector<NvimCell> &p_cells, int32_t p_columns, const NvimPalette &p_palette);
+	void _evict_to(int64_t p_bytes);
+};
+
+} // namespace godot
+
+#endif // NVIM_ROW_TEXTURE_CACHE_H
@@ -0,0 +1,85 @@
+#ifndef NVIM_RPC_READER_H
+#define NVIM_RPC_READER_H
+
+#include "mpack.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace godot {
+
+// One MessagePack-RPC message decoded by the reader thread. The node tree points into
+// the shared read chunk, so messages are only moved around by pointer.
+struct NvimRpcMessage {
+	std::shared_ptr<const std::vector<uint8_t>> chunk;
+	mpack_tree_t tree;
+	bool parsed = false;
+	// Set instead of a tree when the stream could not be decoded; the rest of the chunk is dropped.
+	mpack_error_t error = mpack_ok;
+
+	NvimRpcMessage() = default;
+	NvimRpcMessage(const NvimRpcMessage &) = delete;
+	NvimRpcMessage &operator=(const NvimRpcMessage &) = delete;
+	~NvimRpcMessage();
+
+	mpack_node_t get_root() { return mpack_tree_root(&tree); }
+};
+
+// Reads Neovim's stdout on a worker thread and decodes it into message trees. Redraw
+// notifications are held back until their batch ends in `flush` and are then published
+// together, so the main thread only ever applies whole screen updates and never spends
+// time reading the pipe or parsing MessagePack.
+class NvimRpcReader {
+public:
+	NvimRpcReader() = default;
+	~NvimRpcReader();
+
+	// Takes ownership of p_fd (a duplicate of the client's stdout, so the client may close its own).
+	bool start(int p_fd);
+	void stop();
+	bool is_active() const { return thread.joinable(); }
+
+	// Appends every message published since the last call; returns false when there were none.
+	bool take_messages(std::vector<std::unique_ptr<NvimRpcMessage>> &r_messages);
+	// Blocks up to p_timeout_usec until messages are published; true if some are waiting.
+	bool wait_for_messages(uint64_t p_timeout_usec);
+	// True while redraw events Neovim sent are not yet applied on the main thread: part of a
+	// batch is still held here, or published and not taken. A flush ending that batch was
+	// written before anything the main thread sends now.
+	bool has_unfinished_batch();
+
+	uint64_t get_bytes_read() const { return bytes_read.load(std::memory_order_relaxed); }
+	uint64_t get_frames_published() const { return frames_published.load(std::memory_order_relaxed); }
+
+private:
+	int fd = -1;
+	std::thread thread;
+	std::atomic<bool> running{ false };
+	std::atomic<uint64_t> bytes_read{ 0 };
+	std::atomic<uint64_t> frames_published{ 0 };
+
+	std::mutex mailbox_mutex;
+	std::condition_variable mailbox_ready;
+	std::vector<std::unique_ptr<NvimRpcMessage>> mailbox;
+	bool batch_held = false;
+	bool mailbox_has_redraw = false;
+
+	// Worker-only state.
+	std::vector<uint8_t> tail;
+	std::vector<std::unique_ptr<NvimRpcMessage>> held;
+	bool held_redraw = false;
+
+	void _run();
+	void _decode(std::vector<uint8_t> &&p_incoming);
+	void _publish();
+	static bool _ends_frame(mpack_node_t p_root, bool &r_is_redraw);
+};
+
+} // namespace godot
+
+#endif // NVIM_RPC_READER_H
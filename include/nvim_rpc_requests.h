@@ -0,0 +1,69 @@
+#ifndef NVIM_RPC_REQUESTS_H
+#define NVIM_RPC_REQUESTS_H
+
+#include "mpack.h"
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+
+namespace godot {
+
+// Outcome of a request sent to Neovim. For STATUS_OK, value is the result node; for
+// STATUS_ERROR it is Neovim's [type, message] error. Nodes are only valid during the callback.
+struct NvimRpcResponse {
+	enum Status {
+		STATUS_OK,
+		STATUS_ERROR,
+		STATUS_TIMED_OUT,
+		STATUS_ABORTED,
+		// Part of an nvim_call_atomic batch that stopped at an earlier call.
+		STATUS_NOT_RUN,
+	};
+
+	Status status = STATUS_OK;
+	const mpack_node_t *value = nullptr;
+};
+
+// Requests in flight, keyed by msgid. Each entry runs its callback exactly once: when the
+// response arrives, when its deadline passes, or when Neovim goes away. A cancelled entry
+// never runs, and a response arriving after a timeout or cancel is dropped.
+class NvimRpcRequests {
+public:
+	using Callback = std::function<void(const NvimRpcResponse &)>;
+
+	void add(uint32_t p_msgid, Callback p_callback, uint64_t p_deadline_usec);
+	// Returns false when nothing was waiting for p_msgid.
+	bool complete(uint32_t p_msgid, const mpack_node_t &p_error, const mpack_node_t &p_result);
+	// Runs and removes the entry with a response built locally, such as one call's share of
+	// an nvim_call_atomic result. Returns false when it was cancelled or already finished.
+	bool resolve(uint32_t p_msgid, const NvimRpcResponse &p_response);
+	bool cancel(uint32_t p_msgid);
+	// Fails every request whose deadline is before p_now_usec; returns how many expired.
+	size_t expire(uint64_t p_now_usec);
+	// Fails every pending request with STATUS_ABORTED, e.g. when Neovim exits.
+	void abort_all();
+
+	bool is_pending(uint32_t p_msgid) const { return pending.count(p_msgid) > 0; }
+	size_t get_pending_count() const { return pending.size(); }
+	uint64_t get_responses_dropped() const { return responses_dropped; }
+	uint64_t get_timeouts() const { return timeouts; }
+
+private:
+	struct Entry {
+		Callback callback;
+		uint64_t deadline_usec = 0;
+	};
+
+	std::unordered_map<uint32_t, Entry> pending;
+	// Earliest deadline among pending entries, so expire() is free until something is due.
+	uint64_t next_deadline_usec = UINT64_MAX;
+	uint64_t responses_dropped = 0;
+	uint64_t timeouts = 0;
+
+	void _update_next_deadline();
+};
+
+} // namespace godot
+
+#endif // NVIM_RPC_REQUESTS_H
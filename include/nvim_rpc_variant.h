@@ -0,0 +1,24 @@
+#ifndef NVIM_RPC_VARIANT_H
+#define NVIM_RPC_VARIANT_H
+
+#include <godot_cpp/variant/variant.hpp>
+
+#include "mpack.h"
+
+namespace godot {
+
+// Conversion between Godot Variants and MessagePack for the GDScript-facing RPC API.
+class NvimRpcVariant {
+public:
+	// Writes exactly one value. Packed arrays become arrays, PackedByteArray becomes bin,
+	// StringName and NodePath become strings; types without a MessagePack equivalent are
+	// sent as their string form.
+	static void write(mpack_writer_t *p_writer, const Variant &p_value);
+	// Neovim's Buffer, Window and Tabpage extension types become their integer handles,
+	// which the API accepts back wherever a handle is expected.
+	static Variant from_node(mpack_node_t p_node);
+};
+
+} // namespace godot
+
+#endif // NVIM_RPC_VARIANT_H
@@ -0,0 +1,168 @@
+#ifndef NVIM_RPC_WRITER_H
+#define NVIM_RPC_WRITER_H
+
+#include <godot_cpp/variant/char_string.hpp>
+#include <godot_cpp/variant/string.hpp>
+
+#include "mpack.h"
+#include "nvim_client.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace godot {
+
+// Encodes outbound MessagePack-RPC messages into a persistent arena of fixed-size blocks
+// and sends everything queued since the last flush with a single writev. Blocks are kept
+// between flushes, so steady-state encoding does not allocate. Whatever a full pipe does
+// not take stays queued, in order, for the next flush.
+class NvimRpcWriter {
+public:
+	static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+	NvimRpcWriter();
+
+	// Queues [0, id, method, [args...]] and returns the request id, or 0 if encoding failed.
+	// Arguments may be bools, integers, floating point numbers, C strings, std::string(_view),
+	// String, or callables taking an mpack_writer_t * that write exactly one value.
+	template <typename... Args>
+	uint32_t call(const char *p_method, const Args &...p_args);
+	// Like call(), with a params array of p_count values written by p_write_params.
+	template <typename WriteParams>
+	uint32_t call_with_params(const char *p_method, uint32_t p_count, const WriteParams &p_write_params);
+	// Hands out a request id now for a call that is encoded later with call_with_id().
+	uint32_t reserve_request_id() { return next_request_id++; }
+	template <typename WriteParams>
+	bool call_with_id(uint32_t p_request_id, const char *p_method, uint32_t p_count, const WriteParams &p_write_params);
+	// Queues [2, method, [args...]]; Neovim sends nothing back for a notification.
+	template <typename... Args>
+	bool notify(const char *p_method, const Args &...p_args);
+
+	// Queues [1, msgid, error, result] answering a request from Neovim; each callable writes one value.
+	template <typename WriteError, typename WriteResult>
+	bool respond(uint32_t p_msgid, const WriteError &p_write_error, const WriteResult &p_write_result);
+
+	bool has_pending() const { return pending_bytes > sent_bytes; }
+	size_t get_pending_bytes() const { return pending_bytes - sent_bytes; }
+	// Sends as much of the queue as the pipe takes without waiting; returns false (and drops
+	// the queue) only on a write error.
+	bool flush(NvimClient *p_client);
+	// Drops queued messages, e.g. when Neovim is restarted.
+	void clear();
+
+	uint64_t get_messages_encoded() const { return messages_encoded; }
+	uint64_t get_flushes() const { return flushes; }
+	uint64_t get_bytes_written() const { return bytes_written; }
+	uint64_t get_partial_flushes() const { return partial_flushes; }
+
+private:
+	std::vector<std::unique_ptr<char[]>> blocks;
+	size_t block_index = 0;
+	size_t block_used = 0;
+	size_t pending_bytes = 0;
+	// Bytes at the front of the arena that already reached the pipe.
+	size_t sent_bytes = 0;
+	uint32_t next_request_id = 1;
+
+	// Messages are staged here and spilled into the arena by mpack's flush callback.
+	mpack_writer_t writer;
+	char stage[4096];
+	size_t message_block_index = 0;
+	size_t message_block_used = 0;
+
+	uint64_t messages_encoded = 0;
+	uint64_t flushes = 0;
+	uint64_t bytes_written = 0;
+	uint64_t partial_flushes = 0;
+
+	mpack_writer_t *_begin_message();
+	bool _end_message(const char *p_method);
+	void _append(const char *p_data, size_t p_length);
+	static void _flush_stage(mpack_writer_t *p_writer, const char *p_data, size_t p_length);
+
+	template <typename T>
+	static void _write_arg(mpack_writer_t *p_writer, const T &p_value);
+};
+
+template <typename... Args>
+uint32_t NvimRpcWriter::call(const char *p_method, const Args &...p_args) {
+	return call_with_params(p_method, static_cast<uint32_t>(sizeof...(Args)), [&](mpack_writer_t *p_writer) {
+		(_write_arg(p_writer, p_args), ...);
+	});
+}
+
+template <typename WriteParams>
+uint32_t NvimRpcWriter::call_with_params(const char *p_method, uint32_t p_count, const WriteParams &p_write_params) {
+	uint32_t request_id = reserve_request_id();
+	return call_with_id(request_id, p_method, p_count, p_write_params) ? request_id : 0;
+}
+
+template <typename WriteParams>
+bool NvimRpcWriter::call_with_id(uint32_t p_request_id, const char *p_method, uint32_t p_count, const WriteParams &p_write_params) {
+	mpack_writer_t *message = _begin_message();
+	mpack_start_array(message, 4);
+	mpack_write_i32(message, 0); // Request message type.
+	mpack_write_u32(message, p_request_id);
+	mpack_write_cstr(message, p_method);
+	mpack_start_array(message, p_count);
+	p_write_params(message);
+	mpack_finish_array(message);
+	mpack_finish_array(message);
+	return _end_message(p_method);
+}
+
+template <typename... Args>
+bool NvimRpcWriter::notify(const char *p_method, const Args &...p_args) {
+	mpack_writer_t *message = _begin_message();
+	mpack_start_array(message, 3);
+	mpack_write_i32(message, 2); // Notification message type.
+	mpack_write_cstr(message, p_method);
+	mpack_start_array(message, static_cast<uint32_t>(sizeof...(Args)));
+	(_write_arg(message, p_args), ...);
+	mpack_finish_array(message);
+	mpack_finish_array(message);
+	return _end_message(p_method);
+}
+
+template <typename WriteError, typename WriteResult>
+bool NvimRpcWriter::respond(uint32_t p_msgid, const WriteError &p_write_error, const WriteResult &p_write_result) {
+	mpack_writer_t *message = _begin_message();
+	mpack_start_array(message, 4);
+	mpack_write_i32(message, 1); // Response message type.
+	mpack_write_u32(message, p_msgid);
+	p_write_error(message);
+	p_write_result(message);
+	mpack_finish_array(message);
+	return _end_message("response");
+}
+
+template <typename T>
+void NvimRpcWriter::_write_arg(mpack_writer_t *p_writer, const T &p_value) {
+	if constexpr (std::is_same_v<T, bool>) {
+		mpack_write_bool(p_writer, p_value);
+	} else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+		mpack_write_i64(p_writer, static_cast<int64_t>(p_value));
+	} else if constexpr (std::is_integral_v<T>) {
+		mpack_write_u64(p_writer, static_cast<uint64_t>(p_value));
+	} else if constexpr (std::is_floating_point_v<T>) {
+		mpack_write_double(p_writer, static_cast<double>(p_value));
+	} else if constexpr (std::is_same_v<T, String>) {
+		CharString utf8 = p_value.utf8();
+		mpack_write_str(p_writer, utf8.get_data(), static_cast<uint32_t>(utf8.length()));
+	} else if constexpr (std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view>) {
+		mpack_write_str(p_writer, p_value.data(), static_cast<uint32_t>(p_value.size()));
+	} else if constexpr (std::is_convertible_v<const T &, const char *>) {
+		mpack_write_cstr(p_writer, p_value);
+	} else {
+		p_value(p_writer);
+	}
+}
+
+} // namespace godot
+
+#endif // NVIM_RPC_WRITER_H
@@ -36,9 +36,20 @@ func _ensure_settings() -> void:
 	changed = _ensure_setting("neovim/embed/extra_args", PackedStringArray()) or changed
 	changed = _ensure_setting("neovim/embed/font_path", "res://addons/VimDot/assets/fonts/jetbrains/JetBrainsMonoNerdFontMono-Regular.ttf") or changed
 	changed = _ensure_setting("neovim/embed/font_size", 14) or changed
+	changed = _ensure_setting("neovim/embed/fallback_fonts", PackedStringArray()) or changed
 	changed = _ensure_setting("neovim/embed/hide_script_editor_experimental", false) or changed
 	changed = _ensure_setting("neovim/embed/debug_logging", false) or changed
 	changed = _ensure_setting("neovim/embed/theme", "default") or changed
+	changed = _ensure_setting("neovim/embed/renderer", "canvas") or changed
+	changed = _ensure_setting("neovim/embed/row_texture_cache_mb", 0) or changed
+	changed = _ensure_setting("neovim/embed/row_prepare_tasks", 0) or changed
+	changed = _ensure_setting("neovim/embed/max_fps", 0) or changed
+	changed = _ensure_setting("neovim/embed/resize_interval_ms", 50) or changed
+	changed = _ensure_setting("neovim/embed/smooth_scroll_ms", 0) or changed
+	changed = _ensure_setting("neovim/embed/decode_thread", false) or changed
+	changed = _ensure_setting("neovim/embed/clipboard_provider", true) or changed
+	changed = _ensure_setting("neovim/embed/predictive_echo", false) or changed
+	changed = _ensure_setting("neovim/embed/echo_wait_ms", 0) or changed
 	if changed:
 		ProjectSettings.save()
 
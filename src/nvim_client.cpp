@@ -1,12 +1,16 @@
 #include "nvim_client.h"
 
+#include <algorithm>
 #include <cerrno>
 #include <csignal>
 #include <cstring>
 #include <cstdlib>
 #include <fcntl.h>
+#include <climits>
+#include <poll.h>
 #include <sched.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
@@ -177,6 +181,47 @@ size_t NvimClient::write(const uint8_t *p_data, size_t p_length) {
 	return total_written;
 }
 
+bool NvimClient::write_vectored(const struct iovec *p_segments, size_t p_count, size_t &r_written) {
+	r_written = 0;
+	if (stdin_fd == INVALID_FD) {
+		return false;
+	}
+	if (p_segments == nullptr || p_count == 0) {
+		return true;
+	}
+
+	// writev may stop anywhere, so work on a copy that can be advanced past written bytes.
+	std::vector<iovec> segments(p_segments, p_segments + p_count);
+	size_t first = 0;
+	while (first < segments.size()) {
+		int count = static_cast<int>(std::min<size_t>(segments.size() - first, IOV_MAX));
+		ssize_t result = ::writev(stdin_fd, segments.data() + first, count);
+		if (result > 0) {
+			size_t advanced = static_cast<size_t>(result);
+			r_written += advanced;
+			while (first < segments.size() && advanced >= segments[first].iov_len) {
+				advanced -= segments[first].iov_len;
+				++first;
+			}
+			if (advanced > 0) {
+				segments[first].iov_base = static_cast<char *>(segments[first].iov_base) + advanced;
+				segments[first].iov_len -= advanced;
+			}
+			continue;
+		}
+
+		if (result == -1 && (errno == EINTR)) {
+			continue;
+		}
+
+		// A full pipe is not an error; the caller keeps the rest for its next flush
+		// instead of stalling the editor until Neovim reads.
+		return result == -1 && (errno == EAGAIN || errno == EWOULDBLOCK);
+	}
+
+	return true;
+}
+
 std::vector<uint8_t> NvimClient::read_available() {
 	std::vector<uint8_t> data;
 	if (stdout_fd == INVALID_FD) {
@@ -202,6 +247,30 @@ std::vector<uint8_t> NvimClient::read_available() {
 	return data;
 }
 
+bool NvimClient::wait_readable(uint64_t p_timeout_usec) {
+	if (stdout_fd == INVALID_FD) {
+		return false;
+	}
+
+	pollfd poll_fd;
+	poll_fd.fd = stdout_fd;
+	poll_fd.events = POLLIN;
+	poll_fd.revents = 0;
+	int timeout_ms = static_cast<int>(std::min<uint64_t>((p_timeout_usec + 999) / 1000, INT_MAX));
+	int result;
+	do {
+		result = ::poll(&poll_fd, 1, timeout_ms);
+	} while (result == -1 && errno == EINTR);
+	return result > 0 && (poll_fd.revents & POLLIN);
+}
+
+int NvimClient::duplicate_stdout_fd() const {
+	if (stdout_fd == INVALID_FD) {
+		return INVALID_FD;
+	}
+	return fcntl(stdout_fd, F_DUPFD_CLOEXEC, 0);
+}
+
 void NvimClient::_close_fd(int &p_fd) {
 	if (p_fd != INVALID_FD) {
 		close(p_fd);
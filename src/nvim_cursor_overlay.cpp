@@ -0,0 +1,175 @@
+#include "nvim_cursor_overlay.h"
+
+#include <algorithm>
+
+#include <godot_cpp/classes/global_constants.hpp>
+#include <godot_cpp/classes/rendering_server.hpp>
+#include <godot_cpp/variant/rect2.hpp>
+#include <godot_cpp/variant/transform2d.hpp>
+
+namespace godot {
+
+NvimCursorOverlay::~NvimCursorOverlay() {
+	release();
+}
+
+void NvimCursorOverlay::set_modes(const std::vector<NvimCursorMode> &p_modes, bool p_style_enabled) {
+	modes = p_modes;
+	style_enabled = p_style_enabled;
+	recorded_percentage = -1;
+	_restart_blink();
+}
+
+void NvimCursorOverlay::set_mode(int64_t p_mode_index) {
+	mode_index = p_mode_index;
+	_restart_blink();
+}
+
+void NvimCursorOverlay::set_busy(bool p_busy) {
+	busy = p_busy;
+	_apply_visibility();
+}
+
+void NvimCursorOverlay::move(int64_t p_row, int64_t p_column) {
+	row = p_row;
+	column = p_column;
+	_restart_blink();
+}
+
+const NvimCursorMode &NvimCursorOverlay::get_mode() const {
+	static const NvimCursorMode default_mode;
+	if (!style_enabled || mode_index < 0 || static_cast<size_t>(mode_index) >= modes.size()) {
+		return default_mode;
+	}
+	return modes[static_cast<size_t>(mode_index)];
+}
+
+void NvimCursorOverlay::update(const RID &p_parent_item, NvimFontCache *p_fonts, const NvimCell *p_cell, const NvimPalette &p_palette, const Vector2 &p_grid_origin) {
+	RenderingServer *rs = RenderingServer::get_singleton();
+	if (!rs || !p_parent_item.is_valid()) {
+		return;
+	}
+
+	if (!item.is_valid()) {
+		item = rs->canvas_item_create();
+		rs->canvas_item_set_draw_index(item, DRAW_INDEX);
+		rs->canvas_item_set_visible(item, false);
+		shown = false;
+		recorded_percentage = -1;
+	}
+	if (parent_item != p_parent_item) {
+		parent_item = p_parent_item;
+		rs->canvas_item_set_parent(item, parent_item);
+	}
+
+	Ref<Font> font = p_fonts ? p_fonts->get_font() : Ref<Font>();
+	has_cell = p_cell && font.is_valid();
+	if (!has_cell) {
+		_apply_visibility();
+		return;
+	}
+
+	const NvimFontCache::Metrics &metrics = p_fonts->get_metrics();
+	cell_size = Vector2(metrics.cell_width, metrics.cell_height);
+
+	// attr_id 0 means the cell's colors are swapped; otherwise the cursor highlight's
+	// background fills the shape and its foreground draws the character.
+	const NvimCursorMode &mode = get_mode();
+	Color fill = p_palette.resolve_foreground(p_cell->hl_id);
+	Color text_color = p_palette.resolve_background(p_cell->hl_id);
+	if (mode.attr_id != 0) {
+		auto it = p_palette.highlights.find(mode.attr_id);
+		if (it != p_palette.highlights.end()) {
+			if (it->second.has_background) {
+				fill = it->second.background;
+			}
+			if (it->second.has_foreground) {
+				text_color = it->second.foreground;
+			}
+		}
+	}
+
+	String text = mode.shape == NvimCursorMode::SHAPE_BLOCK ? p_cell->text : String();
+	int32_t percentage = std::clamp(mode.cell_percentage, 1, 100);
+	if (recorded_generation != p_fonts->get_generation() || recorded_cell_size != cell_size || recorded_shape != mode.shape || recorded_percentage != percentage || recorded_fill != fill || recorded_text_color != text_color || recorded_text != text) {
+		recorded_generation = p_fonts->get_generation();
+		recorded_cell_size = cell_size;
+		recorded_shape = mode.shape;
+		recorded_percentage = percentage;
+		recorded_fill = fill;
+		recorded_text_color = text_color;
+		recorded_text = text;
+
+		rs->canvas_item_clear(item);
+		Rect2 rect(Vector2(), cell_size);
+		if (mode.shape == NvimCursorMode::SHAPE_VERTICAL) {
+			rect.size.x = std::max(1.0f, cell_size.x * percentage / 100.0f);
+		} else if (mode.shape == NvimCursorMode::SHAPE_HORIZONTAL) {
+			rect.size.y = std::max(1.0f, cell_size.y * percentage / 100.0f);
+			rect.position.y = cell_size.y - rect.size.y;
+		}
+		rs->canvas_item_add_rect(item, rect, fill);
+		if (!text.is_empty() && text != " ") {
+			font->draw_string(item, Vector2(0.0f, metrics.ascent), text, HORIZONTAL_ALIGNMENT_LEFT, -1, p_fonts->get_font_size(), text_color);
+		}
+	}
+
+	rs->canvas_item_set_transform(item, Transform2D(0.0, p_grid_origin + Vector2(cell_size.x * column, cell_size.y * row)));
+	_apply_visibility();
+}
+
+void NvimCursorOverlay::process(double p_delta) {
+	if (!_blinks() || busy || !has_cell) {
+		return;
+	}
+
+	const NvimCursorMode &mode = get_mode();
+	blink_elapsed_ms += p_delta * 1000.0;
+	for (;;) {
+		int64_t duration = blink_phase == BLINK_WAIT ? mode.blinkwait : (blink_phase == BLINK_ON ? mode.blinkon : mode.blinkoff);
+		if (blink_elapsed_ms < static_cast<double>(duration)) {
+			break;
+		}
+		blink_elapsed_ms -= static_cast<double>(duration);
+		blink_phase = blink_phase == BLINK_OFF ? BLINK_ON : BLINK_OFF;
+		blink_visible = blink_phase == BLINK_ON;
+	}
+	_apply_visibility();
+}
+
+void NvimCursorOverlay::release() {
+	RenderingServer *rs = RenderingServer::get_singleton();
+	if (rs && item.is_valid()) {
+		rs->free_rid(item);
+	}
+	item = RID();
+	parent_item = RID();
+	has_cell = false;
+	shown = false;
+}
+
+bool NvimCursorOverlay::_blinks() const {
+	const NvimCursorMode &mode = get_mode();
+	return mode.blinkwait > 0 && mode.blinkon > 0 && mode.blinkoff > 0;
+}
+
+void NvimCursorOverlay::_restart_blink() {
+	blink_phase = BLINK_WAIT;
+	blink_elapsed_ms = 0.0;
+	blink_visible = true;
+	_apply_visibility();
+}
+
+void NvimCursorOverlay::_apply_visibility() {
+	bool visible = item.is_valid() && has_cell && !busy && blink_visible;
+	if (visible == shown || !item.is_valid()) {
+		return;
+	}
+	RenderingServer *rs = RenderingServer::get_singleton();
+	if (rs) {
+		rs->canvas_item_set_visible(item, visible);
+		shown = visible;
+	}
+}
+
+} // namespace godot
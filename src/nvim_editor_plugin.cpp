@@ -6,7 +6,9 @@
 #include <godot_cpp/classes/project_settings.hpp>
 #include <godot_cpp/classes/script.hpp>
 #include <godot_cpp/classes/script_editor.hpp>
+#include <godot_cpp/classes/script_editor_base.hpp>
 #include <godot_cpp/classes/tab_container.hpp>
+#include <godot_cpp/classes/text_edit.hpp>
 #include <godot_cpp/variant/string.hpp>
 #include <godot_cpp/variant/utility_functions.hpp>
 #include <godot_cpp/variant/variant.hpp>
@@ -201,7 +203,23 @@ void NvimEditorPlugin::_tool_open_current_file() {
 		return;
 	}
 
-	if (!panel->open_file_in_nvim(disk_path)) {
+	// When Godot's script editor shows the same file, open it at the caret position.
+	int64_t line = 0;
+	int64_t column = 0;
+	ScriptEditor *script_editor = editor->get_script_editor();
+	Ref<Script> current_script = script_editor ? script_editor->get_current_script() : Ref<Script>();
+	if (current_script.is_valid() && current_script->get_path() == resource_path) {
+		ScriptEditorBase *script_editor_base = script_editor->get_current_editor();
+		TextEdit *text_edit = script_editor_base ? Object::cast_to<TextEdit>(script_editor_base->get_base_editor()) : nullptr;
+		if (text_edit) {
+			line = text_edit->get_caret_line() + 1;
+			// TextEdit counts characters; nvim_win_set_cursor takes a byte offset.
+			String prefix = text_edit->get_line(text_edit->get_caret_line()).substr(0, text_edit->get_caret_column());
+			column = prefix.to_utf8_buffer().size();
+		}
+	}
+
+	if (!panel->open_file_in_nvim(disk_path, line, column)) {
 		UtilityFunctions::printerr(String("[nvim_embed] Failed to send :edit command for ") + disk_path);
 		return;
 	}
@@ -0,0 +1,206 @@
+#include "nvim_font_cache.h"
+
+#include <godot_cpp/classes/font_variation.hpp>
+#include <godot_cpp/classes/resource_loader.hpp>
+#include <godot_cpp/classes/text_server.hpp>
+#include <godot_cpp/classes/text_server_manager.hpp>
+#include <godot_cpp/classes/theme.hpp>
+#include <godot_cpp/classes/theme_db.hpp>
+#include <godot_cpp/variant/typed_array.hpp>
+#include <godot_cpp/variant/utility_functions.hpp>
+
+namespace godot {
+
+bool NvimFontCache::configure(const String &p_font_path, const PackedStringArray &p_fallback_paths, int32_t p_font_size) {
+	std::vector<Ref<Font>> new_chain;
+	Ref<Font> primary = _load(p_font_path);
+	if (primary.is_null()) {
+		primary = _get_theme_font();
+	}
+	if (primary.is_valid()) {
+		new_chain.push_back(primary);
+	}
+	for (int64_t i = 0; i < p_fallback_paths.size(); ++i) {
+		Ref<Font> fallback = _load(p_fallback_paths[i].strip_edges());
+		if (fallback.is_valid()) {
+			new_chain.push_back(fallback);
+		}
+	}
+
+	int32_t new_size = _resolve_font_size(p_font_size);
+	if (new_chain == chain && new_size == font_size && (chain_font.is_valid() || chain.empty())) {
+		return false;
+	}
+
+	if (new_chain != chain) {
+		metrics_cache.clear();
+		chain_ids.clear();
+		for (const Ref<Font> &font : new_chain) {
+			chain_ids.push_back(font->get_instance_id());
+		}
+	}
+	chain = new_chain;
+	font_size = new_size;
+	if (chain.size() > 1) {
+		// The variation shares the primary font's caches; fallbacks are consulted by the
+		// TextServer in order for anything the primary font does not cover.
+		Ref<FontVariation> variation;
+		variation.instantiate();
+		variation->set_base_font(chain[0]);
+		TypedArray<Font> fallbacks;
+		for (size_t i = 1; i < chain.size(); ++i) {
+			fallbacks.push_back(chain[i]);
+		}
+		variation->set_fallbacks(fallbacks);
+		chain_font = variation;
+	} else {
+		chain_font = chain.empty() ? Ref<Font>() : chain[0];
+	}
+
+	glyph_cache.clear();
+	current_metrics = nullptr;
+	++generation;
+	return true;
+}
+
+const NvimFontCache::Metrics &NvimFontCache::get_metrics() {
+	if (current_metrics) {
+		return *current_metrics;
+	}
+
+	std::pair<std::vector<uint64_t>, int32_t> key(chain_ids, font_size);
+	auto it = metrics_cache.find(key);
+	if (it != metrics_cache.end()) {
+		current_metrics = &it->second;
+		return it->second;
+	}
+
+	Metrics metrics;
+	if (chain_font.is_valid()) {
+		Vector2 char_size = chain_font->get_char_size(U'M', font_size);
+		float cell_w = char_size.x;
+		if (cell_w <= 0.0f) {
+			char_size = chain_font->get_char_size(U' ', font_size);
+			cell_w = char_size.x;
+		}
+		if (cell_w <= 0.0f) {
+			cell_w = chain_font->get_height(font_size) * 0.6f;
+		}
+		float cell_h = chain_font->get_height(font_size);
+		float ascent = chain_font->get_ascent(font_size);
+		metrics.cell_width = cell_w > 0.0f ? cell_w : 1.0f;
+		metrics.cell_height = cell_h > 0.0f ? cell_h : 1.0f;
+		metrics.ascent = ascent >= 0.0f ? ascent : metrics.cell_height * 0.8f;
+	}
+	current_metrics = &metrics_cache.emplace(key, metrics).first->second;
+	return *current_metrics;
+}
+
+RID NvimFontCache::resolve_glyph(char32_t p_codepoint, int64_t &r_glyph) {
+	auto it = glyph_cache.find(p_codepoint);
+	if (it != glyph_cache.end()) {
+		r_glyph = it->second.glyph;
+		return it->second.font_rid;
+	}
+
+	ResolvedGlyph resolved;
+	TextServerManager *ts_manager = TextServerManager::get_singleton();
+	Ref<TextServer> ts = ts_manager ? ts_manager->get_primary_interface() : Ref<TextServer>();
+	if (ts.is_valid()) {
+		for (const Ref<Font> &font : chain) {
+			if (!font->has_char(p_codepoint)) {
+				continue;
+			}
+			TypedArray<RID> rids = font->get_rids();
+			if (rids.is_empty()) {
+				continue;
+			}
+			RID font_rid = rids[0];
+			int64_t glyph = ts->font_get_glyph_index(font_rid, font_size, p_codepoint, 0);
+			if (glyph != 0) {
+				resolved.font_rid = font_rid;
+				resolved.glyph = glyph;
+				break;
+			}
+		}
+	}
+
+	glyph_cache.emplace(p_codepoint, resolved);
+	r_glyph = resolved.glyph;
+	return resolved.font_rid;
+}
+
+Ref<Font> NvimFontCache::_load(const String &p_path) {
+	if (p_path.is_empty()) {
+		return Ref<Font>();
+	}
+
+	auto it = loaded_fonts.find(p_path);
+	if (it != loaded_fonts.end()) {
+		return it->second;
+	}
+
+	Ref<Font> font;
+	ResourceLoader *loader = ResourceLoader::get_singleton();
+	if (loader) {
+		font = loader->load(p_path);
+	}
+	if (font.is_null()) {
+		UtilityFunctions::printerr("[nvim_embed] Failed to load font '", p_path, "'.");
+		return font;
+	}
+	loaded_fonts.emplace(p_path, font);
+	return font;
+}
+
+Ref<Font> NvimFontCache::_get_theme_font() const {
+	ThemeDB *theme_db = ThemeDB::get_singleton();
+	Ref<Theme> theme;
+	if (theme_db) {
+		theme = theme_db->get_project_theme();
+		if (!theme.is_valid()) {
+			theme = theme_db->get_default_theme();
+		}
+	}
+
+	if (theme.is_valid()) {
+		Ref<Font> theme_font = theme->get_font(StringName("font"), StringName("Label"));
+		if (theme_font.is_valid()) {
+			return theme_font;
+		}
+	}
+
+	if (theme_db) {
+		return theme_db->get_fallback_font();
+	}
+	return Ref<Font>();
+}
+
+int32_t NvimFontCache::_resolve_font_size(int32_t p_configured_size) const {
+	ThemeDB *theme_db = ThemeDB::get_singleton();
+	Ref<Theme> theme;
+	if (theme_db) {
+		theme = theme_db->get_project_theme();
+		if (!theme.is_valid()) {
+			theme = theme_db->get_default_theme();
+		}
+	}
+
+	if (theme.is_valid()) {
+		int32_t theme_size = theme->get_font_size(StringName("font_size"), StringName("Label"));
+		if (theme_size > 0) {
+			return theme_size;
+		}
+	}
+
+	if (theme_db) {
+		int32_t fallback_size = theme_db->get_fallback_font_size();
+		if (fallback_size > 0) {
+			return fallback_size;
+		}
+	}
+
+	return p_configured_size;
+}
+
+} // namespace godot
@@ -0,0 +1,218 @@
+#include "nvim_glyph_atlas.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <utility>
+
+#include <godot_cpp/classes/text_server.hpp>
+#include <godot_cpp/classes/text_server_manager.hpp>
+#include <godot_cpp/variant/rect2.hpp>
+#include <godot_cpp/variant/rid.hpp>
+#include <godot_cpp/variant/typed_array.hpp>
+
+namespace godot {
+
+namespace {
+struct PendingGlyph {
+	RID font_rid;
+	int64_t glyph = 0;
+	uint32_t slot = 0;
+	uint32_t width = 1;
+};
+
+struct SourceImage {
+	PackedByteArray data;
+	int32_t width = 0;
+	int32_t height = 0;
+	int32_t bytes_per_pixel = 0;
+	int32_t alpha_offset = 0;
+};
+} // namespace
+
+void NvimGlyphAtlas::configure(NvimFontCache *p_fonts) {
+	if (!p_fonts) {
+		return;
+	}
+
+	const NvimFontCache::Metrics &metrics = p_fonts->get_metrics();
+	Vector2i new_slot_size(std::max(1, static_cast<int32_t>(std::ceil(metrics.cell_width))), std::max(1, static_cast<int32_t>(std::ceil(metrics.cell_height))));
+	if (fonts == p_fonts && font_generation == p_fonts->get_generation() && slot_size == new_slot_size && ascent == metrics.ascent) {
+		return;
+	}
+
+	fonts = p_fonts;
+	font_generation = p_fonts->get_generation();
+	font_size = p_fonts->get_font_size();
+	slot_size = new_slot_size;
+	ascent = metrics.ascent;
+	clear();
+}
+
+void NvimGlyphAtlas::clear() {
+	slots.clear();
+	next_slot = 1;
+	image_size = Vector2i();
+	pixels.clear();
+	_ensure_capacity(0);
+	++generation;
+}
+
+uint32_t NvimGlyphAtlas::find_slot(char32_t p_codepoint) const {
+	auto it = slots.find(p_codepoint);
+	return it != slots.end() ? it->second : 0;
+}
+
+bool NvimGlyphAtlas::add_codepoints(const std::vector<char32_t> &p_codepoints) {
+	if (!fonts) {
+		return false;
+	}
+
+	TextServerManager *ts_manager = TextServerManager::get_singleton();
+	if (!ts_manager) {
+		return false;
+	}
+	Ref<TextServer> ts = ts_manager->get_primary_interface();
+	if (ts.is_null()) {
+		return false;
+	}
+
+	const Vector2i size_key(font_size, 0);
+	std::vector<PendingGlyph> pending;
+	bool changed = false;
+
+	for (char32_t key : p_codepoints) {
+		char32_t codepoint = key & ~WIDE_GLYPH;
+		uint32_t width = (key & WIDE_GLYPH) ? 2 : 1;
+		if (codepoint <= U' ' || slots.count(key) > 0) {
+			continue;
+		}
+		// Both halves of a wide glyph must sit on one atlas row so the right half is slot + 1.
+		if (width == 2 && next_slot % SLOTS_PER_ROW == SLOTS_PER_ROW - 1) {
+			++next_slot;
+		}
+		if (next_slot + width > MAX_SLOTS) {
+			break;
+		}
+
+		uint32_t slot = next_slot;
+		next_slot += width;
+		slots[key] = slot;
+		_ensure_capacity(slot + width - 1);
+		changed = true;
+
+		// The font cache walks the fallback chain; a codepoint nobody covers keeps a blank slot.
+		int64_t glyph = 0;
+		RID font_rid = fonts->resolve_glyph(codepoint, glyph);
+		if (font_rid.is_valid()) {
+			ts->font_render_glyph(font_rid, size_key, glyph);
+			pending.push_back({ font_rid, glyph, slot, width });
+		}
+	}
+
+	// Glyphs are rendered first so every cache texture is fetched once per batch.
+	std::map<std::pair<int64_t, int64_t>, SourceImage> sources;
+	uint8_t *dst = pixels.ptrw();
+	for (const PendingGlyph &pending_glyph : pending) {
+		int64_t texture_index = ts->font_get_glyph_texture_idx(pending_glyph.font_rid, size_key, pending_glyph.glyph);
+		if (texture_index < 0) {
+			continue;
+		}
+
+		SourceImage &source = sources[std::make_pair(pending_glyph.font_rid.get_id(), texture_index)];
+		if (source.width == 0) {
+			Ref<Image> cache_image = ts->font_get_texture_image(pending_glyph.font_rid, size_key, texture_index);
+			if (cache_image.is_null() || cache_image->is_empty()) {
+				continue;
+			}
+			if (cache_image->get_format() == Image::FORMAT_LA8) {
+				source.bytes_per_pixel = 2;
+				source.alpha_offset = 1;
+			} else {
+				if (cache_image->get_format() != Image::FORMAT_RGBA8) {
+					// The cache image is shared with the TextServer; convert a copy.
+					cache_image = cache_image->duplicate();
+					cache_image->convert(Image::FORMAT_RGBA8);
+				}
+				source.bytes_per_pixel = 4;
+				source.alpha_offset = 3;
+			}
+			source.data = cache_image->get_data();
+			source.width = cache_image->get_width();
+			source.height = cache_image->get_height();
+		}
+
+		Rect2 uv_rect = ts->font_get_glyph_uv_rect(pending_glyph.font_rid, size_key, pending_glyph.glyph);
+		Vector2 offset = ts->font_get_glyph_offset(pending_glyph.font_rid, size_key, pending_glyph.glyph);
+		int32_t src_x = static_cast<int32_t>(uv_rect.position.x);
+		int32_t src_y = static_cast<int32_t>(uv_rect.position.y);
+		int32_t glyph_w = static_cast<int32_t>(uv_rect.size.x);
+		int32_t glyph_h = static_cast<int32_t>(uv_rect.size.y);
+		int32_t pen_x = static_cast<int32_t>(std::lround(offset.x));
+		int32_t pen_y = static_cast<int32_t>(std::lround(ascent + offset.y));
+		int32_t slot_x = static_cast<int32_t>(pending_glyph.slot % SLOTS_PER_ROW) * slot_size.x;
+		int32_t slot_y = static_cast<int32_t>(pending_glyph.slot / SLOTS_PER_ROW) * slot_size.y;
+		int32_t clip_w = slot_size.x * static_cast<int32_t>(pending_glyph.width);
+		const uint8_t *src = source.data.ptr();
+
+		for (int32_t y = 0; y < glyph_h; ++y) {
+			int32_t sy = src_y + y;
+			int32_t dy = pen_y + y;
+			if (sy < 0 || sy >= source.height || dy < 0 || dy >= slot_size.y) {
+				continue;
+			}
+			for (int32_t x = 0; x < glyph_w; ++x) {
+				int32_t sx = src_x + x;
+				int32_t dx = pen_x + x;
+				if (sx < 0 || sx >= source.width || dx < 0 || dx >= clip_w) {
+					continue;
+				}
+				uint8_t alpha = src[(static_cast<size_t>(sy) * source.width + sx) * source.bytes_per_pixel + source.alpha_offset];
+				uint8_t *texel = dst + (static_cast<size_t>(slot_y + dy) * image_size.x + slot_x + dx) * 4;
+				texel[0] = 255;
+				texel[1] = 255;
+				texel[2] = 255;
+				texel[3] = std::max(texel[3], alpha);
+			}
+		}
+	}
+
+	if (changed) {
+		++generation;
+	}
+	return changed;
+}
+
+Ref<ImageTexture> NvimGlyphAtlas::get_texture() {
+	if (texture.is_valid() && uploaded_generation == generation) {
+		return texture;
+	}
+
+	image = Image::create_from_data(image_size.x, image_size.y, false, Image::FORMAT_RGBA8, pixels);
+	if (texture.is_null() || texture->get_width() != image_size.x || texture->get_height() != image_size.y) {
+		texture = ImageTexture::create_from_image(image);
+	} else {
+		texture->update(image);
+	}
+	uploaded_generation = generation;
+	return texture;
+}
+
+void NvimGlyphAtlas::_ensure_capacity(uint32_t p_slot) {
+	int32_t needed_rows = static_cast<int32_t>(p_slot / SLOTS_PER_ROW) + 1;
+	int32_t current_rows = image_size.y / std::max(1, slot_size.y);
+	if (image_size.x > 0 && needed_rows <= current_rows) {
+		return;
+	}
+
+	int32_t new_rows = std::max(needed_rows, std::max(4, current_rows * 2));
+	int64_t old_size = pixels.size();
+	image_size = Vector2i(SLOTS_PER_ROW * slot_size.x, new_rows * slot_size.y);
+	int64_t new_size = static_cast<int64_t>(image_size.x) * image_size.y * 4;
+	pixels.resize(new_size);
+	// Rows are appended below the existing ones, so only the new tail needs clearing.
+	std::memset(pixels.ptrw() + old_size, 0, static_cast<size_t>(new_size - old_size));
+}
+
+} // namespace godot
@@ -0,0 +1,274 @@
+#include "nvim_gpu_renderer.h"
+
+#include <algorithm>
+
+#include <godot_cpp/classes/rendering_server.hpp>
+#include <godot_cpp/variant/rect2.hpp>
+#include <godot_cpp/variant/vector2i.hpp>
+
+namespace godot {
+
+namespace {
+// Only texelFetch and integer ops, so this compiles for the Compatibility (GLES3) renderer too.
+const char *GRID_SHADER_CODE = R"(
+shader_type canvas_item;
+render_mode unshaded;
+
+uniform sampler2D glyph_atlas : filter_nearest;
+uniform ivec2 grid_size = ivec2(1, 1);
+uniform vec2 cell_size = vec2(8.0, 16.0);
+uniform ivec2 slot_size = ivec2(8, 16);
+uniform int atlas_columns = 64;
+
+void fragment() {
+	vec2 grid_pos = UV * vec2(grid_size);
+	ivec2 cell = clamp(ivec2(floor(grid_pos)), ivec2(0), grid_size - ivec2(1));
+	vec2 in_cell = (grid_pos - vec2(cell)) * cell_size;
+
+	vec4 glyph_texel = texelFetch(TEXTURE, ivec2(cell.x * 3, cell.y), 0);
+	vec4 fg = texelFetch(TEXTURE, ivec2(cell.x * 3 + 1, cell.y), 0);
+	vec4 bg = texelFetch(TEXTURE, ivec2(cell.x * 3 + 2, cell.y), 0);
+
+	int slot = int(glyph_texel.r * 255.0 + 0.5) + int(glyph_texel.g * 255.0 + 0.5) * 256;
+	int attributes = int(glyph_texel.b * 255.0 + 0.5);
+
+	float coverage = 0.0;
+	if (slot > 0) {
+		ivec2 slot_origin = ivec2(slot % atlas_columns, slot / atlas_columns) * slot_size;
+		ivec2 texel = slot_origin + clamp(ivec2(in_cell), ivec2(0), slot_size - ivec2(1));
+		coverage = texelFetch(glyph_atlas, texel, 0).a;
+	}
+	if ((attributes & 3) != 0 && in_cell.y >= cell_size.y - 1.0) {
+		coverage = 1.0;
+	}
+	if ((attributes & 4) != 0 && abs(in_cell.y - cell_size.y * 0.5) < 0.5) {
+		coverage = 1.0;
+	}
+
+	coverage *= fg.a;
+	COLOR = vec4(mix(bg.rgb, fg.rgb, coverage), max(bg.a, coverage));
+}
+)";
+
+uint8_t _to_byte(float p_value) {
+	return static_cast<uint8_t>(std::clamp(p_value * 255.0f + 0.5f, 0.0f, 255.0f));
+}
+} // namespace
+
+NvimGpuRenderer::~NvimGpuRenderer() {
+	release();
+}
+
+void NvimGpuRenderer::configure(NvimFontCache *p_fonts) {
+	if (!p_fonts) {
+		return;
+	}
+
+	const NvimFontCache::Metrics &metrics = p_fonts->get_metrics();
+	Vector2 new_cell_size(metrics.cell_width, metrics.cell_height);
+	uint64_t generation = atlas.get_generation();
+	atlas.configure(p_fonts);
+	if (atlas.get_generation() != generation) {
+		needs_full_upload = true;
+	}
+	if (cell_size != new_cell_size) {
+		cell_size = new_cell_size;
+		quad_dirty = true;
+	}
+}
+
+void NvimGpuRenderer::draw(const RID &p_parent_item, NvimGrid &p_grid, const NvimPalette &p_palette) {
+	if (p_grid.columns <= 0 || p_grid.rows <= 0) {
+		return;
+	}
+
+	_ensure_canvas_item(p_parent_item);
+	if (!canvas_item.is_valid()) {
+		return;
+	}
+
+	if (columns != p_grid.columns || rows != p_grid.rows) {
+		columns = p_grid.columns;
+		rows = p_grid.rows;
+		_free_row_textures();
+		row_textures.resize(static_cast<size_t>(rows));
+		row_pixels.resize(static_cast<int64_t>(columns) * TEXELS_PER_CELL * 4);
+		needs_full_upload = true;
+		quad_dirty = true;
+	}
+
+	std::vector<int32_t> rows_to_write;
+	std::vector<char32_t> codepoints;
+	for (int32_t row = 0; row < rows && static_cast<size_t>(row) < p_grid.cells.size(); ++row) {
+		if (!needs_full_upload && !p_grid.is_row_dirty(row)) {
+			continue;
+		}
+		rows_to_write.push_back(row);
+		const std::vector<NvimCell> &row_cells = p_grid.cells[static_cast<size_t>(row)];
+		for (size_t col = 0; col < row_cells.size(); ++col) {
+			if (row_cells[col].text.is_empty()) {
+				continue;
+			}
+			char32_t key = row_cells[col].text[0] | (NvimGrid::is_wide_cell(row_cells, col) ? NvimGlyphAtlas::WIDE_GLYPH : 0);
+			if (atlas.find_slot(key) == 0) {
+				codepoints.push_back(key);
+			}
+		}
+	}
+
+	if (rows_to_write.empty() && !quad_dirty) {
+		return;
+	}
+
+	atlas.add_codepoints(codepoints);
+	for (int32_t row : rows_to_write) {
+		_write_row(p_grid, p_palette, row);
+		_upload_row(row);
+	}
+	needs_full_upload = false;
+
+	Vector2i slot_size = atlas.get_slot_size();
+	material->set_shader_parameter("glyph_atlas", atlas.get_texture());
+	material->set_shader_parameter("grid_size", Vector2i(columns, 1));
+	material->set_shader_parameter("cell_size", cell_size);
+	material->set_shader_parameter("slot_size", slot_size);
+	material->set_shader_parameter("atlas_columns", NvimGlyphAtlas::SLOTS_PER_ROW);
+
+	if (quad_dirty) {
+		RenderingServer *rs = RenderingServer::get_singleton();
+		rs->canvas_item_clear(canvas_item);
+		for (int32_t row = 0; row < rows; ++row) {
+			Rect2 quad(Vector2(0, cell_size.y * row), Vector2(cell_size.x * columns, cell_size.y));
+			rs->canvas_item_add_texture_rect(canvas_item, quad, row_textures[static_cast<size_t>(row)].texture);
+		}
+		quad_dirty = false;
+	}
+}
+
+void NvimGpuRenderer::invalidate() {
+	needs_full_upload = true;
+	quad_dirty = true;
+}
+
+void NvimGpuRenderer::release() {
+	RenderingServer *rs = RenderingServer::get_singleton();
+	if (rs && canvas_item.is_valid()) {
+		rs->free_rid(canvas_item);
+	}
+	canvas_item = RID();
+	parent_item = RID();
+	_free_row_textures();
+	material.unref();
+	shader.unref();
+	columns = 0;
+	rows = 0;
+	invalidate();
+}
+
+void NvimGpuRenderer::_ensure_canvas_item(const RID &p_parent_item) {
+	RenderingServer *rs = RenderingServer::get_singleton();
+	if (!rs) {
+		return;
+	}
+
+	if (shader.is_null()) {
+		shader.instantiate();
+		shader->set_code(GRID_SHADER_CODE);
+		material.instantiate();
+		material->set_shader(shader);
+	}
+
+	if (!canvas_item.is_valid()) {
+		canvas_item = rs->canvas_item_create();
+		rs->canvas_item_set_material(canvas_item, material->get_rid());
+		quad_dirty = true;
+	}
+
+	if (parent_item != p_parent_item) {
+		parent_item = p_parent_item;
+		rs->canvas_item_set_parent(canvas_item, parent_item);
+	}
+}
+
+void NvimGpuRenderer::_free_row_textures() {
+	RenderingServer *rs = RenderingServer::get_singleton();
+	for (RowTexture &row_texture : row_textures) {
+		if (rs && row_texture.texture.is_valid()) {
+			rs->free_rid(row_texture.texture);
+		}
+	}
+	row_textures.clear();
+}
+
+void NvimGpuRenderer::_write_row(const NvimGrid &p_grid, const NvimPalette &p_palette, int32_t p_row) {
+	const std::vector<NvimCell> &row_cells = p_grid.cells[static_cast<size_t>(p_row)];
+	uint8_t *row_texels = row_pixels.ptrw();
+	uint32_t continuation_slot = 0;
+
+	for (int32_t col = 0; col < columns; ++col) {
+		uint8_t *texel = row_texels + static_cast<size_t>(col) * TEXELS_PER_CELL * 4;
+		if (static_cast<size_t>(col) >= row_cells.size()) {
+			std::fill(texel, texel + TEXELS_PER_CELL * 4, 0);
+			continue;
+		}
+
+		// The right half of a wide glyph samples the slot after its left half.
+		const NvimCell &cell = row_cells[static_cast<size_t>(col)];
+		uint32_t slot = continuation_slot;
+		continuation_slot = 0;
+		if (!cell.text.is_empty()) {
+			bool wide = NvimGrid::is_wide_cell(row_cells, static_cast<size_t>(col));
+			slot = atlas.find_slot(cell.text[0] | (wide ? NvimGlyphAtlas::WIDE_GLYPH : 0));
+			continuation_slot = (wide && slot != 0) ? slot + 1 : 0;
+		}
+		Color fg = p_palette.resolve_foreground(cell.hl_id);
+		Color bg = p_palette.resolve_background(cell.hl_id);
+
+		uint32_t attributes = p_palette.resolve_attributes(cell.hl_id);
+		uint8_t attribute_bits = 0;
+		if (attributes & NVIM_HL_UNDERLINE) {
+			attribute_bits |= 1;
+		}
+		if (attributes & NVIM_HL_UNDERCURL) {
+			attribute_bits |= 2;
+		}
+		if (attributes & NVIM_HL_STRIKETHROUGH) {
+			attribute_bits |= 4;
+		}
+
+		texel[0] = static_cast<uint8_t>(slot & 0xFF);
+		texel[1] = static_cast<uint8_t>((slot >> 8) & 0xFF);
+		texel[2] = attribute_bits;
+		texel[3] = 255;
+		texel[4] = _to_byte(fg.r);
+		texel[5] = _to_byte(fg.g);
+		texel[6] = _to_byte(fg.b);
+		texel[7] = _to_byte(fg.a);
+		texel[8] = _to_byte(bg.r);
+		texel[9] = _to_byte(bg.g);
+		texel[10] = _to_byte(bg.b);
+		texel[11] = _to_byte(bg.a);
+	}
+}
+
+void NvimGpuRenderer::_upload_row(int32_t p_row) {
+	RenderingServer *rs = RenderingServer::get_singleton();
+	if (!rs) {
+		return;
+	}
+
+	// The Image is reused across frames; set_data copies into its existing buffer.
+	RowTexture &row_texture = row_textures[static_cast<size_t>(p_row)];
+	if (row_texture.image.is_null()) {
+		row_texture.image.instantiate();
+	}
+	row_texture.image->set_data(columns * TEXELS_PER_CELL, 1, false, Image::FORMAT_RGBA8, row_pixels);
+	if (row_texture.texture.is_valid()) {
+		rs->texture_2d_update(row_texture.texture, row_texture.image, 0);
+	} else {
+		row_texture.texture = rs->texture_2d_create(row_texture.image);
+		quad_dirty = true;
+	}
+}
+
+} // namespace godot
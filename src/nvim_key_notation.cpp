@@ -0,0 +1,281 @@
+#include "nvim_key_notation.h"
+
+#include <array>
+
+namespace godot {
+
+namespace {
+constexpr uint8_t NOTATION_CAPACITY = 20;
+
+struct Notation {
+	char text[NOTATION_CAPACITY];
+	uint8_t length;
+};
+
+using NotationRow = std::array<Notation, NvimKeyNotation::MOD_COMBINATIONS>;
+
+constexpr void append_notation(Notation &r_notation, const char *p_text) {
+	while (*p_text) {
+		r_notation.text[r_notation.length++] = *p_text++;
+	}
+}
+
+constexpr Notation make_notation(const char *p_name, uint8_t p_modifiers) {
+	Notation notation{};
+	append_notation(notation, "<");
+	if (p_modifiers & NvimKeyNotation::MOD_CTRL) {
+		append_notation(notation, "C-");
+	}
+	if (p_modifiers & NvimKeyNotation::MOD_SHIFT) {
+		append_notation(notation, "S-");
+	}
+	if (p_modifiers & NvimKeyNotation::MOD_ALT) {
+		append_notation(notation, "A-");
+	}
+	append_notation(notation, p_name);
+	append_notation(notation, ">");
+	return notation;
+}
+
+constexpr Notation make_text(const char *p_text) {
+	Notation notation{};
+	append_notation(notation, p_text);
+	return notation;
+}
+
+constexpr bool notation_is(const Notation &p_notation, const char *p_expected) {
+	uint8_t i = 0;
+	for (; p_expected[i] != '\0'; ++i) {
+		if (i >= p_notation.length || p_notation.text[i] != p_expected[i]) {
+			return false;
+		}
+	}
+	return i == p_notation.length;
+}
+
+// Special keys are indexed by their code below Key::KEY_SPECIAL. Slot 0 is not a Godot key
+// and holds Space, which is only written as <Space> when a modifier is held.
+constexpr uint32_t SPECIAL_KEY_BASE = static_cast<uint32_t>(Key::KEY_SPECIAL);
+constexpr size_t SPACE_SLOT = 0;
+constexpr size_t SPECIAL_KEY_SLOTS = static_cast<uint32_t>(Key::KEY_F24) - SPECIAL_KEY_BASE + 1;
+
+constexpr size_t special_key_slot(Key p_keycode) {
+	uint32_t code = static_cast<uint32_t>(p_keycode);
+	if (p_keycode == Key::KEY_SPACE) {
+		return SPACE_SLOT;
+	}
+	if (code > SPECIAL_KEY_BASE && code - SPECIAL_KEY_BASE < SPECIAL_KEY_SLOTS) {
+		return code - SPECIAL_KEY_BASE;
+	}
+	return SPECIAL_KEY_SLOTS;
+}
+
+struct SpecialKeyName {
+	Key keycode;
+	const char *name;
+	// Shift+Tab arrives as Key::KEY_BACKTAB and is always written with S-.
+	uint8_t implied_modifiers;
+};
+
+constexpr SpecialKeyName SPECIAL_KEY_NAMES[] = {
+	{ Key::KEY_ENTER, "CR", 0 },
+	{ Key::KEY_KP_ENTER, "CR", 0 },
+	{ Key::KEY_TAB, "Tab", 0 },
+	{ Key::KEY_BACKTAB, "Tab", NvimKeyNotation::MOD_SHIFT },
+	{ Key::KEY_ESCAPE, "Esc", 0 },
+	{ Key::KEY_BACKSPACE, "BS", 0 },
+	{ Key::KEY_SPACE, "Space", 0 },
+	{ Key::KEY_UP, "Up", 0 },
+	{ Key::KEY_DOWN, "Down", 0 },
+	{ Key::KEY_LEFT, "Left", 0 },
+	{ Key::KEY_RIGHT, "Right", 0 },
+	{ Key::KEY_HOME, "Home", 0 },
+	{ Key::KEY_END, "End", 0 },
+	{ Key::KEY_PAGEUP, "PageUp", 0 },
+	{ Key::KEY_PAGEDOWN, "PageDown", 0 },
+	{ Key::KEY_INSERT, "Insert", 0 },
+	{ Key::KEY_DELETE, "Del", 0 },
+};
+
+constexpr NotationRow make_row(const char *p_name, uint8_t p_implied_modifiers) {
+	NotationRow row{};
+	for (uint8_t modifiers = 0; modifiers < NvimKeyNotation::MOD_COMBINATIONS; ++modifiers) {
+		row[modifiers] = make_notation(p_name, modifiers | p_implied_modifiers);
+	}
+	return row;
+}
+
+constexpr std::array<NotationRow, SPECIAL_KEY_SLOTS> build_special_key_table() {
+	std::array<NotationRow, SPECIAL_KEY_SLOTS> table{};
+	for (const SpecialKeyName &entry : SPECIAL_KEY_NAMES) {
+		table[special_key_slot(entry.keycode)] = make_row(entry.name, entry.implied_modifiers);
+	}
+	table[SPACE_SLOT][0] = make_text(" ");
+
+	const size_t f1_slot = special_key_slot(Key::KEY_F1);
+	for (int fn = 1; fn <= 24; ++fn) {
+		char name[4] = { 'F', 0, 0, 0 };
+		if (fn < 10) {
+			name[1] = static_cast<char>('0' + fn);
+		} else {
+			name[1] = static_cast<char>('0' + fn / 10);
+			name[2] = static_cast<char>('0' + fn % 10);
+		}
+		table[f1_slot + fn - 1] = make_row(name, 0);
+	}
+	return table;
+}
+
+// Printable ASCII, indexed from ' '. Characters are sent as themselves unless Ctrl or Alt
+// is held; '<' is always escaped so it cannot start a key code in the batched input.
+constexpr char ASCII_FIRST = ' ';
+constexpr size_t ASCII_SLOTS = '~' - ASCII_FIRST + 1;
+
+constexpr std::array<NotationRow, ASCII_SLOTS> build_ascii_table() {
+	std::array<NotationRow, ASCII_SLOTS> table{};
+	for (size_t i = 0; i < ASCII_SLOTS; ++i) {
+		char c = static_cast<char>(ASCII_FIRST + i);
+		char single[2] = { c, 0 };
+		char upper[2] = { c >= 'a' && c <= 'z' ? static_cast<char>(c - 'a' + 'A') : c, 0 };
+		const char *name = c == '<' ? "lt" : (c == ' ' ? "Space" : upper);
+		for (uint8_t modifiers = 0; modifiers < NvimKeyNotation::MOD_COMBINATIONS; ++modifiers) {
+			if (modifiers & (NvimKeyNotation::MOD_CTRL | NvimKeyNotation::MOD_ALT)) {
+				table[i][modifiers] = make_notation(name, modifiers);
+			} else {
+				table[i][modifiers] = c == '<' ? make_text("<lt>") : make_text(single);
+			}
+		}
+	}
+	return table;
+}
+
+constexpr std::array<NotationRow, SPECIAL_KEY_SLOTS> SPECIAL_KEY_TABLE = build_special_key_table();
+constexpr std::array<NotationRow, ASCII_SLOTS> ASCII_TABLE = build_ascii_table();
+
+constexpr const Notation &special_notation(Key p_keycode, uint8_t p_modifiers) {
+	return SPECIAL_KEY_TABLE[special_key_slot(p_keycode)][p_modifiers];
+}
+
+constexpr const Notation &ascii_notation(char p_char, uint8_t p_modifiers) {
+	return ASCII_TABLE[static_cast<size_t>(p_char - ASCII_FIRST)][p_modifiers];
+}
+
+constexpr uint8_t C = NvimKeyNotation::MOD_CTRL;
+constexpr uint8_t S = NvimKeyNotation::MOD_SHIFT;
+constexpr uint8_t A = NvimKeyNotation::MOD_ALT;
+
+static_assert(special_key_slot(Key::KEY_ESCAPE) != SPACE_SLOT && special_key_slot(Key::KEY_ESCAPE) < SPECIAL_KEY_SLOTS, "special keys must not share the Space slot");
+static_assert(special_key_slot(Key::KEY_DELETE) < SPECIAL_KEY_SLOTS && special_key_slot(Key::KEY_PAGEDOWN) < SPECIAL_KEY_SLOTS, "special keys must fit the table");
+static_assert(static_cast<uint32_t>(Key::KEY_F24) - static_cast<uint32_t>(Key::KEY_F1) == 23, "F1-F24 must be contiguous");
+
+static_assert(notation_is(special_notation(Key::KEY_ENTER, 0), "<CR>"), "Enter");
+static_assert(notation_is(special_notation(Key::KEY_KP_ENTER, A), "<A-CR>"), "keypad Enter");
+static_assert(notation_is(special_notation(Key::KEY_TAB, 0), "<Tab>"), "Tab");
+static_assert(notation_is(special_notation(Key::KEY_TAB, C | S), "<C-S-Tab>"), "Ctrl+Shift+Tab");
+static_assert(notation_is(special_notation(Key::KEY_BACKTAB, 0), "<S-Tab>"), "Backtab implies Shift");
+static_assert(notation_is(special_notation(Key::KEY_BACKTAB, C), "<C-S-Tab>"), "Ctrl+Backtab");
+static_assert(notation_is(special_notation(Key::KEY_ESCAPE, 0), "<Esc>"), "Escape");
+static_assert(notation_is(special_notation(Key::KEY_BACKSPACE, C), "<C-BS>"), "Ctrl+Backspace");
+static_assert(notation_is(special_notation(Key::KEY_SPACE, 0), " "), "Space");
+static_assert(notation_is(special_notation(Key::KEY_SPACE, S), "<S-Space>"), "Shift+Space");
+static_assert(notation_is(special_notation(Key::KEY_UP, S), "<S-Up>"), "Shift+Up");
+static_assert(notation_is(special_notation(Key::KEY_PAGEDOWN, C | S | A), "<C-S-A-PageDown>"), "longest notation");
+static_assert(notation_is(special_notation(Key::KEY_DELETE, C), "<C-Del>"), "Ctrl+Delete");
+static_assert(notation_is(special_notation(Key::KEY_F1, 0), "<F1>"), "F1");
+static_assert(notation_is(special_notation(Key::KEY_F12, C | S | A), "<C-S-A-F12>"), "Ctrl+Shift+Alt+F12");
+static_assert(notation_is(special_notation(Key::KEY_F24, 0), "<F24>"), "F24");
+static_assert(special_notation(Key::KEY_SHIFT, 0).length == 0, "modifier keys have no notation");
+
+static_assert(notation_is(ascii_notation('a', 0), "a"), "plain letter");
+static_assert(notation_is(ascii_notation('A', S), "A"), "Shift is part of the character");
+static_assert(notation_is(ascii_notation('a', C), "<C-A>"), "Ctrl+letter");
+static_assert(notation_is(ascii_notation('A', C | S), "<C-S-A>"), "Ctrl+Shift+letter");
+static_assert(notation_is(ascii_notation('x', A), "<A-X>"), "Alt+letter");
+static_assert(notation_is(ascii_notation('1', C), "<C-1>"), "Ctrl+digit");
+static_assert(notation_is(ascii_notation('<', 0), "<lt>"), "less-than is escaped");
+static_assert(notation_is(ascii_notation('<', C), "<C-lt>"), "Ctrl+less-than");
+static_assert(notation_is(ascii_notation('\\', 0), "\\"), "backslash");
+static_assert(notation_is(ascii_notation('~', S), "~"), "last printable character");
+
+void append_utf8(std::string &r_out, char32_t p_char) {
+	if (p_char < 0x80) {
+		r_out += static_cast<char>(p_char);
+	} else if (p_char < 0x800) {
+		r_out += static_cast<char>(0xC0 | (p_char >> 6));
+		r_out += static_cast<char>(0x80 | (p_char & 0x3F));
+	} else if (p_char < 0x10000) {
+		r_out += static_cast<char>(0xE0 | (p_char >> 12));
+		r_out += static_cast<char>(0x80 | ((p_char >> 6) & 0x3F));
+		r_out += static_cast<char>(0x80 | (p_char & 0x3F));
+	} else {
+		r_out += static_cast<char>(0xF0 | (p_char >> 18));
+		r_out += static_cast<char>(0x80 | ((p_char >> 12) & 0x3F));
+		r_out += static_cast<char>(0x80 | ((p_char >> 6) & 0x3F));
+		r_out += static_cast<char>(0x80 | (p_char & 0x3F));
+	}
+}
+
+void append_modifiers(std::string &r_out, uint8_t p_modifiers) {
+	if (p_modifiers & NvimKeyNotation::MOD_CTRL) {
+		r_out += "C-";
+	}
+	if (p_modifiers & NvimKeyNotation::MOD_SHIFT) {
+		r_out += "S-";
+	}
+	if (p_modifiers & NvimKeyNotation::MOD_ALT) {
+		r_out += "A-";
+	}
+}
+} // namespace
+
+bool NvimKeyNotation::append_key(std::string &r_out, Key p_keycode, char32_t p_unicode, uint8_t p_modifiers) {
+	p_modifiers &= MOD_COMBINATIONS - 1;
+	size_t slot = special_key_slot(p_keycode);
+	if (slot < SPECIAL_KEY_SLOTS) {
+		const Notation &notation = SPECIAL_KEY_TABLE[slot][p_modifiers];
+		if (notation.length > 0) {
+			r_out.append(notation.text, notation.length);
+			return true;
+		}
+	}
+
+	// Ctrl and Alt combinations usually arrive without a character; fall back to the key.
+	char32_t base_char = p_unicode;
+	if (base_char == 0) {
+		if (p_keycode >= Key::KEY_A && p_keycode <= Key::KEY_Z) {
+			int offset = static_cast<int>(p_keycode) - static_cast<int>(Key::KEY_A);
+			base_char = static_cast<char32_t>(((p_modifiers & MOD_SHIFT) ? 'A' : 'a') + offset);
+		} else if (p_keycode >= Key::KEY_0 && p_keycode <= Key::KEY_9) {
+			base_char = static_cast<char32_t>('0' + static_cast<int>(p_keycode) - static_cast<int>(Key::KEY_0));
+		}
+	}
+
+	if (base_char < 32 || base_char == 127 || base_char > 0x10FFFF || (base_char >= 0xD800 && base_char <= 0xDFFF)) {
+		return false;
+	}
+
+	if (base_char < 127) {
+		const Notation &notation = ascii_notation(static_cast<char>(base_char), p_modifiers);
+		r_out.append(notation.text, notation.length);
+		return true;
+	}
+
+	if (p_modifiers & (MOD_CTRL | MOD_ALT)) {
+		r_out += '<';
+		append_modifiers(r_out, p_modifiers);
+		append_utf8(r_out, base_char);
+		r_out += '>';
+	} else {
+		append_utf8(r_out, base_char);
+	}
+	return true;
+}
+
+void NvimKeyNotation::append_named(std::string &r_out, const char *p_name, uint8_t p_modifiers) {
+	r_out += '<';
+	append_modifiers(r_out, p_modifiers);
+	r_out += p_name;
+	r_out += '>';
+}
+
+} // namespace godot
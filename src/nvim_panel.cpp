@@ -1,11 +1,16 @@
 #include "nvim_panel.h"
 
 #include <algorithm>
+#include <cmath>
 #include <cstddef>
 #include <cstdlib>
 
 #include <godot_cpp/classes/box_container.hpp>
 #include <godot_cpp/classes/button.hpp>
+#include <godot_cpp/classes/display_server.hpp>
+#include <godot_cpp/classes/editor_interface.hpp>
+#include <godot_cpp/classes/editor_settings.hpp>
+#include <godot_cpp/classes/engine.hpp>
 #include <godot_cpp/classes/file_access.hpp>
 #include <godot_cpp/classes/global_constants.hpp>
 #include <godot_cpp/classes/label.hpp>
@@ -13,17 +18,63 @@
 #include <godot_cpp/classes/project_settings.hpp>
 #include <godot_cpp/classes/theme.hpp>
 #include <godot_cpp/classes/theme_db.hpp>
+#include <godot_cpp/classes/time.hpp>
 #include <godot_cpp/core/math.hpp>
 #include <godot_cpp/variant/char_string.hpp>
 #include <godot_cpp/variant/utility_functions.hpp>
 #include <godot_cpp/core/class_db.hpp>
 
 #include "mpack.h"
+#include "nvim_key_notation.h"
+#include "nvim_predictive_echo.h"
+#include "nvim_rpc_variant.h"
 
 using namespace godot;
 
 namespace {
 constexpr int64_t INVALID_PID = -1;
+// With ext_multigrid, grid 1 is the global grid that windows are placed on.
+constexpr int64_t MULTIGRID_DEFAULT_GRID_ID = 1;
+constexpr uint64_t BACKGROUND_POLL_INTERVAL_USEC = 250000;
+// Requests without a response by then fail with a timeout; a late response is dropped.
+constexpr uint64_t REQUEST_TIMEOUT_USEC = 30000000;
+// Neovim --embed blocks startup until a UI attaches, so a layout that never settles
+// (e.g. a canvas with no size yet) falls back to the last known grid size.
+constexpr uint64_t ATTACH_LAYOUT_TIMEOUT_USEC = 500000;
+// Pastes are streamed through nvim_paste one chunk at a time, each well under the usual
+// 64 KB pipe buffer, so a large paste never backs up the writer.
+constexpr size_t PASTE_CHUNK_BYTES = 32 * 1024;
+constexpr int32_t PASTE_CHUNKS_IN_FLIGHT = 1;
+// Wheel and trackpad deltas are summed per frame and sent as whole wheel steps. A pan
+// gesture of this many units counts as one step; the step count per frame is capped so a
+// fling cannot queue seconds of scrolling.
+constexpr double PAN_DELTA_PER_WHEEL_STEP = 1.0;
+constexpr int32_t WHEEL_STEPS_PER_FRAME_MAX = 12;
+constexpr int32_t ECHO_WAIT_MAX_MS = 8;
+
+// Installs the panel as Neovim's clipboard provider unless the user configured one. Takes
+// the UI channel id; the provider is reloaded in case something already probed the clipboard.
+constexpr const char *CLIPBOARD_PROVIDER_LUA = R"lua(
+local chan = ...
+if vim.g.clipboard ~= nil then
+	return false
+end
+local function copy(lines, regtype)
+	vim.rpcrequest(chan, 'vimdot_clipboard_set', lines, regtype)
+end
+local function paste()
+	return vim.rpcrequest(chan, 'vimdot_clipboard_get')
+end
+vim.g.clipboard = {
+	name = 'godot',
+	copy = { ['+'] = copy, ['*'] = copy },
+	paste = { ['+'] = paste, ['*'] = paste },
+	cache_enabled = 0,
+}
+vim.g.loaded_clipboard_provider = nil
+vim.cmd('runtime autoload/provider/clipboard.vim')
+return true
+)lua";
 }
 
 void NvimGridCanvas::_bind_methods() {}
@@ -57,6 +108,7 @@ NvimPanel::NvimPanel() {
 	nvim_client = std::make_unique<NvimClient>();
 	_ensure_grid(current_grid_id, grid_columns, grid_rows);
 	_reset_highlight_defaults();
+	_register_clipboard_handlers();
 }
 
 NvimPanel::~NvimPanel() {
@@ -71,17 +123,48 @@ void NvimPanel::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("get_nvim_command"), &NvimPanel::get_nvim_command);
 	ClassDB::bind_method(D_METHOD("send_input", "keys"), &NvimPanel::send_input);
 	ClassDB::bind_method(D_METHOD("send_command", "command"), &NvimPanel::send_command);
-	ClassDB::bind_method(D_METHOD("open_file_in_nvim", "path"), &NvimPanel::open_file_in_nvim);
+	ClassDB::bind_method(D_METHOD("open_file_in_nvim", "path", "line", "column"), &NvimPanel::open_file_in_nvim, DEFVAL(0), DEFVAL(0));
+	ClassDB::bind_method(D_METHOD("request", "method", "args"), &NvimPanel::request, DEFVAL(Array()));
+	ClassDB::bind_method(D_METHOD("cancel_request", "id"), &NvimPanel::cancel_request);
+	ClassDB::bind_method(D_METHOD("begin_batch"), &NvimPanel::begin_batch);
+	ClassDB::bind_method(D_METHOD("end_batch"), &NvimPanel::end_batch);
+	ClassDB::bind_method(D_METHOD("register_request_handler", "method", "handler"), &NvimPanel::register_request_handler);
+	ClassDB::bind_method(D_METHOD("unregister_request_handler", "method"), &NvimPanel::unregister_request_handler);
+	ClassDB::bind_method(D_METHOD("get_stats"), &NvimPanel::get_stats);
+#ifdef DEBUG_ENABLED
+	ClassDB::bind_method(D_METHOD("benchmark_row_prepare", "iterations"), &NvimPanel::benchmark_row_prepare);
+	ClassDB::bind_method(D_METHOD("benchmark_key_translation", "iterations"), &NvimPanel::benchmark_key_translation);
+	ClassDB::bind_method(D_METHOD("check_wide_glyphs"), &NvimPanel::check_wide_glyphs);
+#endif
 
 	ADD_PROPERTY(PropertyInfo(Variant::STRING, "nvim_command"), "set_nvim_command", "get_nvim_command");
 }
 
+void NvimPanel::_notification(int32_t p_what) {
+	if (p_what == NOTIFICATION_VISIBILITY_CHANGED && is_inside_tree()) {
+		_set_background(!is_visible_in_tree());
+	} else if (p_what == NOTIFICATION_THEME_CHANGED && is_node_ready()) {
+		_refresh_fonts();
+	}
+	Control::_notification(p_what);
+}
+
 void NvimPanel::_ready() {
 	set_anchors_preset(PRESET_FULL_RECT);
 	set_process(true);
 	_ensure_ui_created();
 	reload_settings();
 	_update_ui_state();
+	in_background = !is_visible_in_tree();
+	// The theme font size follows the editor's interface settings.
+	EditorInterface *editor = EditorInterface::get_singleton();
+	Ref<EditorSettings> editor_settings = editor ? editor->get_editor_settings() : Ref<EditorSettings>();
+	if (editor_settings.is_valid()) {
+		Callable on_changed = callable_mp(this, &NvimPanel::_refresh_fonts);
+		if (!editor_settings->is_connected("settings_changed", on_changed)) {
+			editor_settings->connect("settings_changed", on_changed);
+		}
+	}
 	if (autostart && !is_running()) {
 		call_deferred("start_nvim");
 	}
@@ -92,8 +175,47 @@ void NvimPanel::_exit_tree() {
 }
 
 void NvimPanel::_process(double p_delta) {
-	(void)p_delta;
+	if (batch_depth > 0) {
+		// An unbalanced begin_batch() would otherwise hold every later call back forever.
+		UtilityFunctions::printerr("[nvim_embed] begin_batch() was not matched by end_batch() within the frame; sending the batch.");
+		batch_depth = 0;
+		_send_batch();
+	}
+	if (attach_pending) {
+		_attach_when_laid_out();
+	}
+
+	if (in_background) {
+		// Nothing is drawn while hidden. The pipe is still drained now and then so a burst
+		// sent before the detach cannot fill it and stall Neovim.
+		Time *time = Time::get_singleton();
+		uint64_t now_usec = time ? time->get_ticks_usec() : 0;
+		if (now_usec - last_background_poll_usec >= BACKGROUND_POLL_INTERVAL_USEC) {
+			last_background_poll_usec = now_usec;
+			_poll_nvim();
+		}
+		rpc_requests.expire(now_usec);
+		_flush_outbound();
+		return;
+	}
+
 	_poll_nvim();
+	Time *time = Time::get_singleton();
+	rpc_requests.expire(time ? time->get_ticks_usec() : 0);
+	_flush_pending_resize();
+	_pump_paste();
+	_flush_outbound();
+	_wait_for_echo();
+	_present_pending_frame();
+	cursor_overlay.process(p_delta);
+	bool scrolled = false;
+	for (auto &entry : row_renderers) {
+		scrolled = entry.second->is_scroll_animating() || scrolled;
+		entry.second->process_scroll_animation(p_delta);
+	}
+	if (scrolled) {
+		_update_cursor();
+	}
 }
 
 void NvimPanel::_ensure_ui_created() {
@@ -112,6 +234,8 @@ void NvimPanel::_ensure_ui_created() {
 	grid_canvas->set_h_size_flags(SIZE_FILL | SIZE_EXPAND);
 	grid_canvas->set_v_size_flags(SIZE_FILL | SIZE_EXPAND);
 	grid_canvas->set_focus_mode(FOCUS_ALL);
+	// While a resize is in flight the old grid is shown clipped to the new bounds.
+	grid_canvas->set_clip_contents(true);
 	root->add_child(grid_canvas);
 
 	status_overlay = memnew(CenterContainer);
@@ -164,15 +288,31 @@ void NvimPanel::start_nvim() {
 
 	nvim_crashed = false;
 
+	cursor_overlay.set_modes(std::vector<NvimCursorMode>(), false);
+	cursor_overlay.set_busy(false);
 	grids.clear();
+	grid_placements.clear();
+	grid_toplines.clear();
 	_ensure_grid(current_grid_id, grid_columns, grid_rows);
-	highlight_definitions.clear();
+	palette.highlights.clear();
 	_apply_theme_defaults(true);
 
 	if (!nvim_client) {
 		nvim_client = std::make_unique<NvimClient>();
 	}
 
+	rpc_reader.stop();
+	decoded_messages.clear();
+	rpc_writer.clear();
+	pending_keys.clear();
+	input_echo_start_usec = 0;
+	echo_wait_answered = true;
+	_abort_batch();
+	rpc_requests.abort_all();
+	_cancel_paste();
+	_reset_mouse_coalescing();
+	predictive_echo.release();
+	nvim_mode_name = String();
 	stdout_buffer.clear();
 
 	CharString cmd_utf8 = nvim_command.utf8();
@@ -212,9 +352,21 @@ void NvimPanel::start_nvim() {
 	if (debug_logging_enabled) {
 		UtilityFunctions::print("[nvim_embed] Launched Neovim process (pid = ", nvim_pid, ")");
 	}
+	if (decode_thread_setting && !rpc_reader.start(nvim_client->duplicate_stdout_fd())) {
+		UtilityFunctions::printerr("[nvim_embed] Failed to start the decode thread; reading Neovim output on the main thread.");
+	}
 	_update_ui_state();
 
-	_send_ui_attach();
+	Time *time = Time::get_singleton();
+	nvim_start_usec = time ? time->get_ticks_usec() : 0;
+	awaiting_first_frame = true;
+	first_frame_flushed = false;
+	time_to_first_frame_usec = -1;
+	attach_pending = true;
+	attach_probe_columns = 0;
+	attach_probe_rows = 0;
+	clipboard_provider_requested = false;
+	_attach_when_laid_out();
 
 	if (grid_canvas) {
 		grid_canvas->grab_focus();
@@ -226,15 +378,33 @@ void NvimPanel::stop_nvim() {
 		return;
 	}
 
+	rpc_reader.stop();
+	decoded_messages.clear();
+	rpc_writer.clear();
+	pending_keys.clear();
+	input_echo_start_usec = 0;
+	echo_wait_answered = true;
+	_abort_batch();
+	rpc_requests.abort_all();
+	_cancel_paste();
+	_reset_mouse_coalescing();
+	predictive_echo.release();
+	nvim_mode_name = String();
 	if (nvim_client->is_running()) {
 		nvim_client->stop();
 	}
 
 	nvim_pid = INVALID_PID;
 	stdout_buffer.clear();
+	multigrid_attached = false;
+	ui_attached = false;
+	attach_pending = false;
+	awaiting_first_frame = false;
 	grids.clear();
+	grid_placements.clear();
+	grid_toplines.clear();
 	_ensure_grid(current_grid_id, grid_columns, grid_rows);
-	highlight_definitions.clear();
+	palette.highlights.clear();
 	_apply_theme_defaults(true);
 	nvim_crashed = false;
 	_update_ui_state();
@@ -248,7 +418,426 @@ bool NvimPanel::send_command(const String &p_command) {
 	return _send_nvim_command(p_command);
 }
 
-bool NvimPanel::open_file_in_nvim(const String &p_path) {
+Ref<NvimRequest> NvimPanel::request(const String &p_method, const Array &p_args) {
+	Ref<NvimRequest> pending_request;
+	pending_request.instantiate();
+	if (!nvim_client || !nvim_client->is_running()) {
+		pending_request->setup(get_instance_id(), 0, p_method);
+		pending_request->call_deferred("_fail", "Neovim is not running");
+		return pending_request;
+	}
+
+	// The table holds the only strong reference besides the caller's, so an unawaited
+	// request still completes and is then released.
+	uint32_t request_id = 0;
+	bool queued = _queue_call(p_method, p_args, [pending_request](const NvimRpcResponse &p_response) {
+		switch (p_response.status) {
+			case NvimRpcResponse::STATUS_OK:
+				pending_request->finish(NvimRpcVariant::from_node(*p_response.value));
+				break;
+			case NvimRpcResponse::STATUS_ERROR:
+				pending_request->fail(_format_rpc_error(*p_response.value));
+				break;
+			case NvimRpcResponse::STATUS_TIMED_OUT:
+				pending_request->fail("timed out");
+				break;
+			case NvimRpcResponse::STATUS_ABORTED:
+				pending_request->fail("Neovim stopped");
+				break;
+			case NvimRpcResponse::STATUS_NOT_RUN:
+				pending_request->fail("not run: an earlier call in the batch failed");
+				break;
+		}
+	},
+			&request_id);
+	pending_request->setup(get_instance_id(), request_id, p_method);
+	if (!queued) {
+		pending_request->call_deferred("_fail", "Could not encode the request arguments");
+	}
+	return pending_request;
+}
+
+void NvimPanel::begin_batch() {
+	++batch_depth;
+}
+
+bool NvimPanel::end_batch() {
+	if (batch_depth == 0) {
+		return false;
+	}
+	if (--batch_depth > 0) {
+		return true;
+	}
+	return _send_batch();
+}
+
+bool NvimPanel::_queue_call(const String &p_method, const Array &p_args, NvimRpcRequests::Callback p_callback, uint32_t *r_request_id) {
+	if (r_request_id) {
+		*r_request_id = 0;
+	}
+	if (batch_depth > 0) {
+		BatchCall call;
+		call.method = p_method;
+		call.args = p_args;
+		call.request_id = rpc_writer.reserve_request_id();
+		_track_request(call.request_id, std::move(p_callback));
+		if (r_request_id) {
+			*r_request_id = call.request_id;
+		}
+		batch_calls.push_back(std::move(call));
+		return true;
+	}
+
+	// Calls queue behind keys typed earlier in the frame.
+	_flush_pending_keys();
+	CharString method_utf8 = p_method.utf8();
+	uint32_t request_id = rpc_writer.call_with_params(method_utf8.get_data(), static_cast<uint32_t>(p_args.size()), [&p_args](mpack_writer_t *p_writer) {
+		for (int64_t i = 0; i < p_args.size(); ++i) {
+			NvimRpcVariant::write(p_writer, p_args[i]);
+		}
+	});
+	if (request_id == 0) {
+		return false;
+	}
+	_track_request(request_id, std::move(p_callback));
+	if (r_request_id) {
+		*r_request_id = request_id;
+	}
+	return true;
+}
+
+bool NvimPanel::_send_batch() {
+	std::vector<BatchCall> calls;
+	calls.swap(batch_calls);
+	if (calls.empty()) {
+		return true;
+	}
+
+	_flush_pending_keys();
+	NvimRpcResponse aborted;
+	aborted.status = NvimRpcResponse::STATUS_ABORTED;
+	if (calls.size() == 1) {
+		const Array &args = calls[0].args;
+		CharString method_utf8 = calls[0].method.utf8();
+		bool queued = rpc_writer.call_with_id(calls[0].request_id, method_utf8.get_data(), static_cast<uint32_t>(args.size()), [&args](mpack_writer_t *p_writer) {
+			for (int64_t i = 0; i < args.size(); ++i) {
+				NvimRpcVariant::write(p_writer, args[i]);
+			}
+		});
+		if (!queued) {
+			rpc_requests.resolve(calls[0].request_id, aborted);
+		}
+		return queued;
+	}
+
+	uint32_t request_id = rpc_writer.call_with_params("nvim_call_atomic", 1, [&calls](mpack_writer_t *p_writer) {
+		mpack_start_array(p_writer, static_cast<uint32_t>(calls.size()));
+		for (const BatchCall &call : calls) {
+			mpack_start_array(p_writer, 2);
+			CharString method_utf8 = call.method.utf8();
+			mpack_write_str(p_writer, method_utf8.get_data(), static_cast<uint32_t>(method_utf8.length()));
+			NvimRpcVariant::write(p_writer, call.args);
+			mpack_finish_array(p_writer);
+		}
+		mpack_finish_array(p_writer);
+	});
+
+	std::vector<uint32_t> call_ids;
+	call_ids.reserve(calls.size());
+	for (const BatchCall &call : calls) {
+		call_ids.push_back(call.request_id);
+	}
+	if (request_id == 0) {
+		for (uint32_t call_id : call_ids) {
+			rpc_requests.resolve(call_id, aborted);
+		}
+		return false;
+	}
+
+	++batches_sent;
+	batched_calls_sent += static_cast<int64_t>(call_ids.size());
+	// nvim_call_atomic answers [results, error]: one result per call that ran, and either nil
+	// or [index, type, message] for the call that failed; later calls were not run. Each share
+	// goes to the call's own entry, which is skipped if it was cancelled or timed out.
+	_track_request(request_id, [this, call_ids](const NvimRpcResponse &p_response) {
+		if (p_response.status != NvimRpcResponse::STATUS_OK) {
+			for (uint32_t call_id : call_ids) {
+				rpc_requests.resolve(call_id, p_response);
+			}
+			return;
+		}
+
+		const mpack_node_t &result = *p_response.value;
+		mpack_node_t results_node = mpack_node_array_at(result, 0);
+		mpack_node_t error_node = mpack_node_array_at(result, 1);
+		size_t completed = std::min(mpack_node_array_length(results_node), call_ids.size());
+		for (size_t i = 0; i < completed; ++i) {
+			mpack_node_t value_node = mpack_node_array_at(results_node, i);
+			NvimRpcResponse call_response;
+			call_response.value = &value_node;
+			rpc_requests.resolve(call_ids[i], call_response);
+		}
+
+		size_t failed_index = call_ids.size();
+		if (mpack_node_type(error_node) == mpack_type_array && mpack_node_array_length(error_node) > 0) {
+			failed_index = static_cast<size_t>(std::max<int64_t>(mpack_node_i64(mpack_node_array_at(error_node, 0)), 0));
+		}
+		for (size_t i = completed; i < call_ids.size(); ++i) {
+			NvimRpcResponse call_response;
+			call_response.status = i == failed_index ? NvimRpcResponse::STATUS_ERROR : NvimRpcResponse::STATUS_NOT_RUN;
+			call_response.value = i == failed_index ? &error_node : nullptr;
+			rpc_requests.resolve(call_ids[i], call_response);
+		}
+	});
+	return true;
+}
+
+void NvimPanel::register_request_handler(const String &p_method, const Callable &p_handler) {
+	CharString method_utf8 = p_method.utf8();
+	if (!p_handler.is_valid()) {
+		request_handlers.erase(method_utf8.get_data());
+		return;
+	}
+	request_handlers[method_utf8.get_data()] = [p_handler](const mpack_node_t &p_params, String &r_error) -> Variant {
+		if (!p_handler.is_valid()) {
+			r_error = "handler is no longer valid";
+			return Variant();
+		}
+		Array args;
+		if (mpack_node_type(p_params) == mpack_type_array) {
+			args = NvimRpcVariant::from_node(p_params);
+		}
+		Variant result = p_handler.callv(args);
+		_take_handler_error(result, r_error);
+		return result;
+	};
+}
+
+bool NvimPanel::_take_handler_error(Variant &r_result, String &r_error) {
+	// GDScript handlers fail by returning {"error": message}.
+	if (r_result.get_type() != Variant::DICTIONARY) {
+		return false;
+	}
+	Dictionary dict = r_result;
+	if (dict.size() != 1 || !dict.has("error")) {
+		return false;
+	}
+	r_error = String(dict["error"]);
+	r_result = Variant();
+	return true;
+}
+
+void NvimPanel::unregister_request_handler(const String &p_method) {
+	CharString method_utf8 = p_method.utf8();
+	request_handlers.erase(method_utf8.get_data());
+}
+
+void NvimPanel::_handle_nvim_request(const mpack_node_t &p_root) {
+	if (mpack_node_array_length(p_root) < 2) {
+		return;
+	}
+	mpack_node_t msgid_node = mpack_node_array_at(p_root, 1);
+	if (mpack_node_type(msgid_node) != mpack_type_uint && mpack_node_type(msgid_node) != mpack_type_int) {
+		return;
+	}
+	uint32_t msgid = mpack_node_u32(msgid_node);
+
+	// Neovim blocks in rpcrequest() until it gets an answer, so every path with a msgid responds.
+	mpack_node_t method_node = mpack_node_array_length(p_root) >= 4 ? mpack_node_array_at(p_root, 2) : msgid_node;
+	if (mpack_node_type(method_node) != mpack_type_str) {
+		_respond(msgid, "malformed request", Variant());
+		return;
+	}
+	std::string method(mpack_node_str(method_node), mpack_node_strlen(method_node));
+
+	auto it = request_handlers.find(method);
+	if (it == request_handlers.end()) {
+		++nvim_requests_unknown;
+		String method_name = String::utf8(method.data(), static_cast<int64_t>(method.size()));
+		if (debug_logging_enabled) {
+			UtilityFunctions::print("[nvim_embed] No handler for RPC request from Neovim: ", method_name);
+		}
+		_respond(msgid, "method not found: " + method_name, Variant());
+		return;
+	}
+
+	// The handler may unregister itself, which would destroy the map entry mid-call.
+	RequestHandler handler = it->second;
+	String error;
+	Variant result = handler(mpack_node_array_at(p_root, 3), error);
+
+	// A handler that awaits returns its function state; the answer goes out when it completes.
+	Object *state = error.is_empty() && result.get_type() == Variant::OBJECT ? static_cast<Object *>(result) : nullptr;
+	if (state && state->is_class("GDScriptFunctionState")) {
+		Callable on_completed = callable_mp(this, &NvimPanel::_on_request_handler_completed).bind(static_cast<int64_t>(msgid), static_cast<int64_t>(nvim_start_usec));
+		state->connect("completed", on_completed, CONNECT_ONE_SHOT);
+		return;
+	}
+
+	++nvim_requests_answered;
+	_respond(msgid, error, error.is_empty() ? result : Variant());
+}
+
+void NvimPanel::_on_request_handler_completed(const Variant &p_result, int64_t p_msgid, int64_t p_start_usec) {
+	// A restarted Neovim never sent this request.
+	if (!is_running() || static_cast<uint64_t>(p_start_usec) != nvim_start_usec) {
+		return;
+	}
+	Variant result = p_result;
+	String error;
+	_take_handler_error(result, error);
+	++nvim_requests_answered;
+	_respond(static_cast<uint32_t>(p_msgid), error, result);
+}
+
+void NvimPanel::_respond(uint32_t p_msgid, const String &p_error, const Variant &p_result) {
+	rpc_writer.respond(
+			p_msgid,
+			[&p_error](mpack_writer_t *p_writer) {
+				if (p_error.is_empty()) {
+					mpack_write_nil(p_writer);
+					return;
+				}
+				// Same [type, message] shape Neovim uses for its own errors.
+				mpack_start_array(p_writer, 2);
+				mpack_write_i32(p_writer, 0);
+				CharString error_utf8 = p_error.utf8();
+				mpack_write_str(p_writer, error_utf8.get_data(), static_cast<uint32_t>(error_utf8.length()));
+				mpack_finish_array(p_writer);
+			},
+			[&p_result](mpack_writer_t *p_writer) {
+				NvimRpcVariant::write(p_writer, p_result);
+			});
+}
+
+void NvimPanel::_register_clipboard_handlers() {
+	// Served in-process, so yanks and puts with + and * never fork xclip or wl-copy.
+	request_handlers["vimdot_clipboard_set"] = [this](const mpack_node_t &p_params, String &r_error) -> Variant {
+		DisplayServer *display_server = DisplayServer::get_singleton();
+		if (!display_server) {
+			r_error = "no display server";
+			return Variant();
+		}
+		if (mpack_node_type(p_params) != mpack_type_array || mpack_node_array_length(p_params) < 1) {
+			r_error = "expected lines and regtype";
+			return Variant();
+		}
+
+		mpack_node_t lines_node = mpack_node_array_at(p_params, 0);
+		if (mpack_node_type(lines_node) != mpack_type_array) {
+			r_error = "expected a list of lines";
+			return Variant();
+		}
+		String text;
+		size_t line_count = mpack_node_array_length(lines_node);
+		for (size_t i = 0; i < line_count; ++i) {
+			mpack_node_t line_node = mpack_node_array_at(lines_node, i);
+			if (i > 0) {
+				text += "\n";
+			}
+			if (mpack_node_type(line_node) == mpack_type_str) {
+				text += String::utf8(mpack_node_str(line_node), static_cast<int64_t>(mpack_node_strlen(line_node)));
+			}
+		}
+
+		String regtype = "v";
+		if (mpack_node_array_length(p_params) >= 2) {
+			mpack_node_t regtype_node = mpack_node_array_at(p_params, 1);
+			if (mpack_node_type(regtype_node) == mpack_type_str) {
+				regtype = String::utf8(mpack_node_str(regtype_node), static_cast<int64_t>(mpack_node_strlen(regtype_node)));
+			}
+		}
+		// Linewise yanks end with a newline on the system clipboard, as with other providers.
+		String clipboard_text = regtype == "V" ? text + "\n" : text;
+		display_server->clipboard_set(clipboard_text);
+		clipboard_last_text = clipboard_text;
+		clipboard_last_regtype = regtype;
+		++clipboard_sets;
+		return Variant();
+	};
+
+	request_handlers["vimdot_clipboard_get"] = [this](const mpack_node_t &p_params, String &r_error) -> Variant {
+		(void)p_params;
+		DisplayServer *display_server = DisplayServer::get_singleton();
+		if (!display_server) {
+			r_error = "no display server";
+			return Variant();
+		}
+
+		String text = display_server->clipboard_get().replace("\r\n", "\n");
+		String regtype;
+		if (text == clipboard_last_text) {
+			// Our own yank; keep its register type, including blockwise widths.
+			regtype = clipboard_last_regtype;
+		} else {
+			regtype = text.ends_with("\n") ? "V" : "v";
+		}
+		if (regtype == "V" && text.ends_with("\n")) {
+			text = text.substr(0, text.length() - 1);
+		}
+		++clipboard_gets;
+
+		Array result;
+		result.push_back(text.split("\n"));
+		result.push_back(regtype);
+		return result;
+	};
+}
+
+void NvimPanel::_install_clipboard_provider() {
+	clipboard_provider_requested = true;
+	// The provider calls back on the UI channel, whose id only Neovim knows.
+	_queue_call("nvim_get_api_info", Array(), [this](const NvimRpcResponse &p_response) {
+		if (p_response.status != NvimRpcResponse::STATUS_OK || mpack_node_type(*p_response.value) != mpack_type_array) {
+			return;
+		}
+		mpack_node_t channel_node = mpack_node_array_at(*p_response.value, 0);
+		if (mpack_node_type(channel_node) != mpack_type_uint && mpack_node_type(channel_node) != mpack_type_int) {
+			return;
+		}
+
+		Array lua_args;
+		lua_args.push_back(mpack_node_i64(channel_node));
+		Array args;
+		args.push_back(CLIPBOARD_PROVIDER_LUA);
+		args.push_back(lua_args);
+		_queue_call("nvim_exec_lua", args, [this](const NvimRpcResponse &p_install_response) {
+			if (p_install_response.status == NvimRpcResponse::STATUS_ERROR) {
+				UtilityFunctions::printerr("[nvim_embed] Failed to install the clipboard provider: ", _format_rpc_error(*p_install_response.value));
+			} else if (p_install_response.status == NvimRpcResponse::STATUS_OK && debug_logging_enabled) {
+				bool installed = mpack_node_type(*p_install_response.value) == mpack_type_bool && mpack_node_bool(*p_install_response.value);
+				UtilityFunctions::print(installed ? "[nvim_embed] Serving the clipboard from Godot." : "[nvim_embed] Keeping the g:clipboard set by the user config.");
+			}
+		});
+	});
+}
+
+void NvimPanel::_abort_batch() {
+	std::vector<BatchCall> calls;
+	calls.swap(batch_calls);
+	NvimRpcResponse response;
+	response.status = NvimRpcResponse::STATUS_ABORTED;
+	for (const BatchCall &call : calls) {
+		rpc_requests.resolve(call.request_id, response);
+	}
+}
+
+bool NvimPanel::cancel_request(int64_t p_id) {
+	if (p_id <= 0 || p_id > UINT32_MAX) {
+		return false;
+	}
+	uint32_t request_id = static_cast<uint32_t>(p_id);
+	// A call still waiting in an open batch is not sent at all.
+	for (auto it = batch_calls.begin(); it != batch_calls.end(); ++it) {
+		if (it->request_id == request_id) {
+			batch_calls.erase(it);
+			break;
+		}
+	}
+	return rpc_requests.cancel(request_id);
+}
+
+bool NvimPanel::open_file_in_nvim(const String &p_path, int64_t p_line, int64_t p_column) {
 	if (!nvim_client || !nvim_client->is_running()) {
 		return false;
 	}
@@ -258,8 +847,252 @@ bool NvimPanel::open_file_in_nvim(const String &p_path) {
 	}
 
 	String quoted_path = _quote_path_for_command(p_path);
-	return send_command("edit " + quoted_path);
+	if (p_line <= 0) {
+		return send_command("edit " + quoted_path);
+	}
+
+	// One nvim_call_atomic, so Neovim redraws once with the cursor already in place.
+	BatchScope batch(this);
+	bool sent = send_command("edit " + quoted_path);
+	Array cursor;
+	cursor.push_back(p_line);
+	cursor.push_back(std::max<int64_t>(p_column, 0));
+	Array args;
+	args.push_back(0);
+	args.push_back(cursor);
+	sent = _queue_call("nvim_win_set_cursor", args, nullptr) && sent;
+	return send_command("normal! zz") && sent;
+}
+
+Dictionary NvimPanel::get_stats() const {
+	Dictionary stats;
+	uint64_t rows_recorded = 0;
+	uint64_t rows_shaped = 0;
+	uint64_t rows_shape_reused = 0;
+	for (const auto &entry : row_renderers) {
+		rows_recorded += entry.second->get_rows_recorded();
+		rows_shaped += entry.second->get_shaper().get_rows_shaped();
+		rows_shape_reused += entry.second->get_shaper().get_rows_reused();
+	}
+	stats["rows_recorded"] = static_cast<int64_t>(rows_recorded);
+	stats["rows_shaped"] = static_cast<int64_t>(rows_shaped);
+	stats["rows_shape_reused"] = static_cast<int64_t>(rows_shape_reused);
+	stats["row_cache_hits"] = static_cast<int64_t>(row_texture_cache ? row_texture_cache->get_hits() : 0);
+	stats["row_cache_misses"] = static_cast<int64_t>(row_texture_cache ? row_texture_cache->get_misses() : 0);
+	stats["row_cache_entries"] = static_cast<int64_t>(row_texture_cache ? row_texture_cache->get_entry_count() : 0);
+	stats["row_cache_bytes"] = row_texture_cache ? row_texture_cache->get_memory_used() : 0;
+	stats["row_cache_limit_bytes"] = row_texture_cache_limit;
+	stats["frames_presented_per_second"] = frames_presented_per_second;
+	stats["frames_coalesced_per_second"] = frames_coalesced_per_second;
+	stats["resize_requests_sent"] = resize_requests_sent;
+	stats["resize_events_coalesced"] = resize_events_coalesced;
+	stats["time_to_first_frame_msec"] = time_to_first_frame_usec >= 0 ? time_to_first_frame_usec / 1000.0 : -1.0;
+	stats["decode_thread_active"] = rpc_reader.is_active();
+	stats["decode_thread_bytes"] = static_cast<int64_t>(rpc_reader.get_bytes_read());
+	stats["decode_thread_frames"] = static_cast<int64_t>(rpc_reader.get_frames_published());
+	stats["rpc_messages_sent"] = static_cast<int64_t>(rpc_writer.get_messages_encoded());
+	stats["rpc_writes"] = static_cast<int64_t>(rpc_writer.get_flushes());
+	stats["rpc_bytes_written"] = static_cast<int64_t>(rpc_writer.get_bytes_written());
+	stats["rpc_partial_writes"] = static_cast<int64_t>(rpc_writer.get_partial_flushes());
+	stats["rpc_backlog_bytes"] = static_cast<int64_t>(rpc_writer.get_pending_bytes());
+	stats["rpc_requests_pending"] = static_cast<int64_t>(rpc_requests.get_pending_count());
+	stats["rpc_request_timeouts"] = static_cast<int64_t>(rpc_requests.get_timeouts());
+	stats["rpc_responses_dropped"] = static_cast<int64_t>(rpc_requests.get_responses_dropped());
+	stats["rpc_batches_sent"] = batches_sent;
+	stats["rpc_batched_calls"] = batched_calls_sent;
+	stats["nvim_requests_answered"] = nvim_requests_answered;
+	stats["nvim_requests_unknown"] = nvim_requests_unknown;
+	stats["pastes_started"] = pastes_started;
+	stats["paste_bytes_sent"] = paste_bytes_sent;
+	stats["clipboard_gets"] = clipboard_gets;
+	stats["clipboard_sets"] = clipboard_sets;
+	stats["echo_predictions"] = static_cast<int64_t>(predictive_echo.get_predicted());
+	stats["echo_predictions_confirmed"] = static_cast<int64_t>(predictive_echo.get_confirmed());
+	stats["echo_predictions_rolled_back"] = static_cast<int64_t>(predictive_echo.get_rolled_back());
+	stats["mouse_events_received"] = mouse_events_received;
+	stats["mouse_events_sent"] = mouse_events_sent;
+	stats["mouse_messages_sent"] = mouse_messages_sent;
+	stats["key_inputs_queued"] = key_inputs_queued;
+	stats["key_input_calls_sent"] = key_input_calls_sent;
+	stats["input_echo_latency_msec"] = last_input_echo_usec >= 0 ? last_input_echo_usec / 1000.0 : -1.0;
+	stats["input_echo_latency_avg_msec"] = input_echo_samples > 0 ? input_echo_total_usec / 1000.0 / input_echo_samples : -1.0;
+	stats["input_echo_frames_avg"] = input_echo_samples > 0 ? static_cast<double>(input_echo_total_frames) / input_echo_samples : -1.0;
+	stats["echo_waits"] = echo_waits;
+	stats["echo_wait_hits"] = echo_wait_hits;
+	stats["echo_wait_avg_msec"] = echo_waits > 0 ? echo_wait_total_usec / 1000.0 / echo_waits : 0.0;
+	return stats;
+}
+
+#ifdef DEBUG_ENABLED
+Dictionary NvimPanel::benchmark_row_prepare(int32_t p_iterations) {
+	// Synthetic 400x120 grid with short highlight runs and some decorations, so every
+	// row produces background runs, per-column colors and lines.
+	const int32_t columns = 400;
+	const int32_t rows = 120;
+	const int32_t highlight_count = 16;
+	const String alphabet = "abcdefghijklmnopqrstuvwxyz_(){}=;0123456789 ";
+
+	NvimGrid grid;
+	grid.columns = columns;
+	grid.rows = rows;
+	grid.cells.assign(static_cast<size_t>(rows), std::vector<NvimCell>(static_cast<size_t>(columns)));
+	for (int32_t row = 0; row < rows; ++row) {
+		for (int32_t col = 0; col < columns; ++col) {
+			NvimCell &cell = grid.cells[static_cast<size_t>(row)][static_cast<size_t>(col)];
+			cell.text = alphabet.substr((row * 7 + col * 13) % alphabet.length(), 1);
+			cell.hl_id = 1 + (row * 3 + col / 6) % highlight_count;
+		}
+	}
+
+	NvimPalette bench_palette;
+	bench_palette.default_foreground = palette.default_foreground;
+	bench_palette.default_background = palette.default_background;
+	for (int64_t hl_id = 1; hl_id <= highlight_count; ++hl_id) {
+		NvimHighlight highlight;
+		highlight.foreground = Color::from_hsv(hl_id / static_cast<float>(highlight_count), 0.6f, 0.9f);
+		highlight.background = Color::from_hsv(hl_id / static_cast<float>(highlight_count), 0.3f, 0.2f);
+		highlight.has_foreground = true;
+		highlight.has_background = hl_id % 2 == 0;
+		highlight.attributes = hl_id % 5 == 0 ? NVIM_HL_UNDERLINE : 0;
+		bench_palette.highlights[hl_id] = highlight;
+	}
+
+	std::vector<int32_t> row_list(static_cast<size_t>(rows));
+	for (int32_t row = 0; row < rows; ++row) {
+		row_list[static_cast<size_t>(row)] = row;
+	}
+
+	NvimRowRenderer renderer;
+	renderer.configure(&font_cache);
+	int32_t iterations = std::max(p_iterations, 1);
+	Dictionary results;
+	const int32_t task_counts[] = { 1, 2, 4, 8 };
+	for (int32_t tasks : task_counts) {
+		renderer.prepare_rows(grid, bench_palette, row_list, tasks);
+		uint64_t start_usec = Time::get_singleton()->get_ticks_usec();
+		for (int32_t i = 0; i < iterations; ++i) {
+			renderer.prepare_rows(grid, bench_palette, row_list, tasks);
+		}
+		uint64_t elapsed_usec = Time::get_singleton()->get_ticks_usec() - start_usec;
+		results[tasks] = static_cast<double>(elapsed_usec) / iterations;
+	}
+
+	if (debug_logging_enabled) {
+		UtilityFunctions::print("[nvim_embed] Row prepare usec per 400x120 pass (tasks: usec): ", results);
+	}
+	return results;
+}
+
+Dictionary NvimPanel::benchmark_key_translation(int32_t p_iterations) {
+	// A typing mix: letters, Shift, Ctrl and Alt chords, navigation keys and non-ASCII text.
+	struct BenchKey {
+		Key keycode;
+		char32_t unicode;
+		uint8_t modifiers;
+	};
+	const uint8_t C = NvimKeyNotation::MOD_CTRL;
+	const uint8_t S = NvimKeyNotation::MOD_SHIFT;
+	const uint8_t A = NvimKeyNotation::MOD_ALT;
+	const BenchKey keys[] = {
+		{ Key::KEY_A, 'a', 0 },
+		{ Key::KEY_Z, 'Z', S },
+		{ Key::KEY_SPACE, ' ', 0 },
+		{ Key::KEY_0, '0', 0 },
+		{ Key::KEY_W, 0, C },
+		{ Key::KEY_R, 0, C | S },
+		{ Key::KEY_X, 0, A },
+		{ Key::KEY_ESCAPE, 0, 0 },
+		{ Key::KEY_ENTER, 0, 0 },
+		{ Key::KEY_TAB, 0, C | S },
+		{ Key::KEY_BACKTAB, 0, S },
+		{ Key::KEY_PAGEDOWN, 0, C },
+		{ Key::KEY_UP, 0, S },
+		{ Key::KEY_F5, 0, 0 },
+		{ Key::KEY_LESS, '<', S },
+		{ Key::KEY_NONE, 0x00E9, 0 },
+	};
+	const int32_t key_count = static_cast<int32_t>(sizeof(keys) / sizeof(keys[0]));
+
+	std::string buffer;
+	buffer.reserve(4096);
+	int32_t iterations = std::max(p_iterations, 1);
+	uint64_t translated = 0;
+	uint64_t start_usec = Time::get_singleton()->get_ticks_usec();
+	for (int32_t i = 0; i < iterations; ++i) {
+		for (const BenchKey &key : keys) {
+			translated += NvimKeyNotation::append_key(buffer, key.keycode, key.unicode, key.modifiers) ? 1 : 0;
+		}
+		if (buffer.size() > 3072) {
+			buffer.clear();
+		}
+	}
+	uint64_t elapsed_usec = Time::get_singleton()->get_ticks_usec() - start_usec;
+
+	Dictionary results;
+	results["keys"] = static_cast<int64_t>(iterations) * key_count;
+	results["keys_translated"] = static_cast<int64_t>(translated);
+	results["nsec_per_key"] = elapsed_usec * 1000.0 / (static_cast<double>(iterations) * key_count);
+	if (debug_logging_enabled) {
+		UtilityFunctions::print("[nvim_embed] Key translation: ", results);
+	}
+	return results;
+}
+
+bool NvimPanel::check_wide_glyphs() {
+	// The cells Neovim sends for "中a": the CJK character, its empty right half, then 'a'.
+	char buffer[64];
+	mpack_writer_t writer;
+	mpack_writer_init(&writer, buffer, sizeof(buffer));
+	mpack_start_array(&writer, 3);
+	mpack_start_array(&writer, 2);
+	mpack_write_utf8_cstr(&writer, "\xe4\xb8\xad");
+	mpack_write_i64(&writer, 1);
+	mpack_finish_array(&writer);
+	mpack_start_array(&writer, 1);
+	mpack_write_utf8_cstr(&writer, "");
+	mpack_finish_array(&writer);
+	mpack_start_array(&writer, 1);
+	mpack_write_utf8_cstr(&writer, "a");
+	mpack_finish_array(&writer);
+	mpack_finish_array(&writer);
+	size_t size = mpack_writer_buffer_used(&writer);
+	if (mpack_writer_destroy(&writer) != mpack_ok) {
+		return false;
+	}
+
+	mpack_tree_t tree;
+	mpack_tree_init_data(&tree, buffer, size);
+	mpack_tree_parse(&tree);
+	std::vector<NvimCell> row(4);
+	int64_t end_column = _write_grid_line_cells(row, 0, mpack_tree_root(&tree));
+	bool parsed = mpack_tree_destroy(&tree) == mpack_ok;
+
+	String failure;
+	if (!parsed || end_column != 3) {
+		failure = "grid_line cells were not decoded";
+	} else if (!row[1].text.is_empty() || !NvimGrid::is_wide_cell(row, 0) || NvimGrid::is_wide_cell(row, 2)) {
+		failure = "the right half of a wide character is not kept as an empty cell";
+	} else {
+		NvimGlyphAtlas atlas;
+		atlas.configure(&font_cache);
+		char32_t key = row[0].text[0] | NvimGlyphAtlas::WIDE_GLYPH;
+		atlas.add_codepoints({ key, static_cast<char32_t>(row[2].text[0]) });
+		uint32_t slot = atlas.find_slot(key);
+		if (slot == 0 || slot % NvimGlyphAtlas::SLOTS_PER_ROW == NvimGlyphAtlas::SLOTS_PER_ROW - 1 || atlas.find_slot(row[2].text[0]) == slot + 1) {
+			failure = "the wide character did not get two adjacent atlas slots";
+		}
+	}
+
+	if (!failure.is_empty()) {
+		UtilityFunctions::printerr("[nvim_embed] Wide glyph check failed: ", failure);
+		return false;
+	}
+	if (debug_logging_enabled) {
+		UtilityFunctions::print("[nvim_embed] Wide glyph check passed");
+	}
+	return true;
 }
+#endif
 
 void NvimPanel::_update_ui_state() {
 	const bool running = is_running();
@@ -303,15 +1136,37 @@ void NvimPanel::_poll_nvim() {
 			}
 			nvim_crashed = true;
 			nvim_pid = INVALID_PID;
+			multigrid_attached = false;
+			ui_attached = false;
+			attach_pending = false;
+			awaiting_first_frame = false;
+			rpc_reader.stop();
+			decoded_messages.clear();
+			rpc_writer.clear();
+			pending_keys.clear();
+			input_echo_start_usec = 0;
+			_abort_batch();
+			rpc_requests.abort_all();
+			_cancel_paste();
+			_reset_mouse_coalescing();
+			predictive_echo.release();
+			nvim_mode_name = String();
 			_update_ui_state();
 			grids.clear();
+			grid_placements.clear();
+			grid_toplines.clear();
 			_ensure_grid(current_grid_id, grid_columns, grid_rows);
-			highlight_definitions.clear();
+			palette.highlights.clear();
 			_apply_theme_defaults(true);
 		}
 		return;
 	}
 
+	if (rpc_reader.is_active()) {
+		_apply_decoded_messages();
+		return;
+	}
+
 	std::vector<uint8_t> incoming = nvim_client->read_available();
 	if (!incoming.empty()) {
 		stdout_buffer.insert(stdout_buffer.end(), incoming.begin(), incoming.end());
@@ -351,44 +1206,86 @@ bool NvimPanel::_try_process_message() {
 	}
 
 	mpack_node_t root = mpack_tree_root(&tree);
-	if (mpack_node_type(root) != mpack_type_array) {
+	if (!_dispatch_message(root)) {
 		mpack_tree_destroy(&tree);
 		stdout_buffer.clear();
+		return false;
+	}
+
+	size_t consumed = mpack_tree_size(&tree);
+	mpack_tree_destroy(&tree);
+
+	if (consumed == 0 || consumed > stdout_buffer.size()) {
+		stdout_buffer.clear();
+		return false;
+	}
+
+	stdout_buffer.erase(stdout_buffer.begin(), stdout_buffer.begin() + static_cast<std::ptrdiff_t>(consumed));
+	return true;
+}
+
+void NvimPanel::_apply_decoded_messages() {
+	if (!rpc_reader.take_messages(decoded_messages)) {
+		return;
+	}
+
+	// Everything up to the last published flush; trees were already parsed by the reader.
+	for (std::unique_ptr<NvimRpcMessage> &message : decoded_messages) {
+		if (message->error != mpack_ok) {
+			const char *error_text = mpack_error_to_string(message->error);
+			String error_string = error_text ? String::utf8(error_text) : String();
+			UtilityFunctions::printerr("[nvim_embed] Failed to parse MessagePack from Neovim (error ", static_cast<int64_t>(message->error), ": ", error_string, ")");
+			continue;
+		}
+		_dispatch_message(message->get_root());
+	}
+	decoded_messages.clear();
+}
+
+bool NvimPanel::_dispatch_message(const mpack_node_t &p_root) {
+	if (mpack_node_type(p_root) != mpack_type_array) {
 		UtilityFunctions::printerr("[nvim_embed] Unexpected root type in RPC message.");
 		return false;
 	}
 
-	uint32_t outer_size = mpack_node_array_length(root);
+	uint32_t outer_size = mpack_node_array_length(p_root);
 	if (outer_size == 0) {
-		mpack_tree_destroy(&tree);
-		stdout_buffer.clear();
 		UtilityFunctions::printerr("[nvim_embed] Empty RPC message received.");
 		return false;
 	}
 
-	mpack_node_t type_node = mpack_node_array_at(root, 0);
+	mpack_node_t type_node = mpack_node_array_at(p_root, 0);
 	int32_t message_type = mpack_node_i32(type_node);
 
 	switch (message_type) {
-		case 0: // Request
-			if (debug_logging_enabled) {
-				UtilityFunctions::print("[nvim_embed] Ignoring RPC request from Neovim (not implemented yet).");
-			}
+		case 0: // Request: [0, msgid, method, params]
+			_handle_nvim_request(p_root);
 			break;
-		case 1: // Response
-			// TODO: Track pending requests if we need results.
+		case 1: { // Response: [1, msgid, error, result]
+			if (outer_size < 4) {
+				break;
+			}
+			mpack_node_t msgid_node = mpack_node_array_at(p_root, 1);
+			if (mpack_node_type(msgid_node) != mpack_type_uint && mpack_node_type(msgid_node) != mpack_type_int) {
+				break;
+			}
+			uint32_t msgid = mpack_node_u32(msgid_node);
+			if (!rpc_requests.complete(msgid, mpack_node_array_at(p_root, 2), mpack_node_array_at(p_root, 3)) && debug_logging_enabled) {
+				UtilityFunctions::print("[nvim_embed] Dropped response to request #", static_cast<int64_t>(msgid), " (timed out or cancelled).");
+			}
 			break;
+		}
 		case 2: { // Notification
 			if (outer_size < 2) {
 				break;
 			}
 
-			mpack_node_t method_node = mpack_node_array_at(root, 1);
+			mpack_node_t method_node = mpack_node_array_at(p_root, 1);
 			size_t method_len = mpack_node_strlen(method_node);
 			String method = String::utf8(mpack_node_str(method_node), static_cast<int64_t>(method_len));
 
 			if (method == "redraw" && outer_size >= 3) {
-				mpack_node_t batches_node = mpack_node_array_at(root, 2);
+				mpack_node_t batches_node = mpack_node_array_at(p_root, 2);
 				if (mpack_node_type(batches_node) == mpack_type_array) {
 					_handle_redraw(batches_node);
 				}
@@ -405,15 +1302,6 @@ bool NvimPanel::_try_process_message() {
 			break;
 	}
 
-	size_t consumed = mpack_tree_size(&tree);
-	mpack_tree_destroy(&tree);
-
-	if (consumed == 0 || consumed > stdout_buffer.size()) {
-		stdout_buffer.clear();
-		return false;
-	}
-
-	stdout_buffer.erase(stdout_buffer.begin(), stdout_buffer.begin() + static_cast<std::ptrdiff_t>(consumed));
 	return true;
 }
 
@@ -422,62 +1310,41 @@ void NvimPanel::_send_ui_attach() {
 		return;
 	}
 
-	uint32_t request_id = next_request_id++;
-
-	char *buffer = nullptr;
-	size_t buffer_size = 0;
-	mpack_writer_t writer;
-	mpack_writer_init_growable(&writer, &buffer, &buffer_size);
-
-	mpack_start_array(&writer, 4);
-	mpack_write_i32(&writer, 0); // Request message type.
-	mpack_write_u32(&writer, request_id);
-	mpack_write_cstr(&writer, "nvim_ui_attach");
-
-	mpack_start_array(&writer, 3);
-	mpack_write_u32(&writer, static_cast<uint32_t>(std::max(grid_columns, 1)));
-	mpack_write_u32(&writer, static_cast<uint32_t>(std::max(grid_rows, 1)));
-
-	mpack_start_map(&writer, 4);
-	mpack_write_cstr(&writer, "rgb");
-	mpack_write_bool(&writer, true);
-	mpack_write_cstr(&writer, "ext_linegrid");
-	mpack_write_bool(&writer, true);
-	mpack_write_cstr(&writer, "ext_hlstate");
-	mpack_write_bool(&writer, true);
-	mpack_write_cstr(&writer, "ext_termcolors");
-	mpack_write_bool(&writer, true);
-	mpack_finish_map(&writer);
-	mpack_finish_array(&writer);
-	mpack_finish_array(&writer);
-
-	mpack_error_t writer_error = mpack_writer_destroy(&writer);
-	if (writer_error != mpack_ok) {
-		if (buffer) {
-			std::free(buffer);
+	// Window grids are only needed to scroll windows independently, so ext_multigrid is
+	// attached just for smooth scrolling with the canvas renderer.
+	multigrid_attached = smooth_scroll_time > 0.0 && renderer_setting == "canvas";
+	bool multigrid = multigrid_attached;
+	auto options = [multigrid](mpack_writer_t *p_writer) {
+		mpack_start_map(p_writer, multigrid ? 5 : 4);
+		mpack_write_cstr(p_writer, "rgb");
+		mpack_write_bool(p_writer, true);
+		mpack_write_cstr(p_writer, "ext_linegrid");
+		mpack_write_bool(p_writer, true);
+		mpack_write_cstr(p_writer, "ext_hlstate");
+		mpack_write_bool(p_writer, true);
+		mpack_write_cstr(p_writer, "ext_termcolors");
+		mpack_write_bool(p_writer, true);
+		if (multigrid) {
+			mpack_write_cstr(p_writer, "ext_multigrid");
+			mpack_write_bool(p_writer, true);
 		}
-		UtilityFunctions::printerr("[nvim_embed] Failed to encode nvim_ui_attach request (error code ", static_cast<int64_t>(writer_error), ")");
-		return;
-	}
-
-	if (!buffer || buffer_size == 0) {
-		UtilityFunctions::printerr("[nvim_embed] Generated empty nvim_ui_attach payload");
-		if (buffer) {
-			std::free(buffer);
+		mpack_finish_map(p_writer);
+	};
+
+	uint32_t request_id = rpc_writer.call("nvim_ui_attach", static_cast<uint32_t>(std::max(grid_columns, 1)), static_cast<uint32_t>(std::max(grid_rows, 1)), options);
+	ui_attached = request_id != 0;
+	if (ui_attached) {
+		_track_request(request_id, [this](const NvimRpcResponse &p_response) {
+			if (p_response.status == NvimRpcResponse::STATUS_ERROR) {
+				UtilityFunctions::printerr("[nvim_embed] nvim_ui_attach failed: ", _format_rpc_error(*p_response.value));
+			}
+		});
+		if (clipboard_provider_setting && !clipboard_provider_requested) {
+			_install_clipboard_provider();
 		}
-		return;
-	}
-
-	size_t written = nvim_client->write(reinterpret_cast<const uint8_t *>(buffer), buffer_size);
-	std::free(buffer);
-
-	if (written != buffer_size) {
-		UtilityFunctions::printerr("[nvim_embed] Failed to write full nvim_ui_attach request (", static_cast<int64_t>(written), "/", static_cast<int64_t>(buffer_size), " bytes)");
-		return;
 	}
-
-	if (debug_logging_enabled) {
-		UtilityFunctions::print("[nvim_embed] Sent nvim_ui_attach request (#", static_cast<int64_t>(request_id), ")");
+	if (ui_attached && debug_logging_enabled) {
+		UtilityFunctions::print("[nvim_embed] Queued nvim_ui_attach request (#", static_cast<int64_t>(request_id), ")");
 	}
 }
 
@@ -517,6 +1384,10 @@ void NvimPanel::_handle_redraw_event(const String &p_event_name, const mpack_nod
 	if (mpack_node_type(p_args_node) != mpack_type_array) {
 		return;
 	}
+	if (p_event_name != "flush") {
+		redraw_batch_open = true;
+		redraw_batch_touched_grid = redraw_batch_touched_grid || p_event_name.begins_with("grid_");
+	}
 
 	if (p_event_name == "grid_resize") {
 		_handle_grid_resize(p_args_node);
@@ -534,6 +1405,53 @@ void NvimPanel::_handle_redraw_event(const String &p_event_name, const mpack_nod
 		_handle_hl_attr_define(p_args_node);
 	} else if (p_event_name == "default_colors_set") {
 		_handle_default_colors_set(p_args_node);
+	} else if (p_event_name == "mode_info_set") {
+		_handle_mode_info_set(p_args_node);
+	} else if (p_event_name == "mode_change") {
+		_handle_mode_change(p_args_node);
+	} else if (p_event_name == "busy_start") {
+		cursor_overlay.set_busy(true);
+	} else if (p_event_name == "busy_stop") {
+		cursor_overlay.set_busy(false);
+	} else if (p_event_name == "flush") {
+		if (awaiting_first_frame && ui_attached) {
+			awaiting_first_frame = false;
+			first_frame_flushed = true;
+		}
+		if (input_echo_start_usec != 0 && !input_echo_unsent && input_echo_skip_batch) {
+			// This batch was already underway when the keys reached Neovim.
+			input_echo_skip_batch = false;
+		} else if (input_echo_start_usec != 0 && !input_echo_unsent && redraw_batch_touched_grid) {
+			// The screen update answering the keys; counted from the oldest key in the batch.
+			// Frames are counted too: 0 means the echo is drawn in the frame the key arrived in.
+			Time *time = Time::get_singleton();
+			uint64_t now_usec = time ? time->get_ticks_usec() : input_echo_start_usec;
+			last_input_echo_usec = static_cast<int64_t>(now_usec - input_echo_start_usec);
+			input_echo_total_usec += last_input_echo_usec;
+			input_echo_total_frames += static_cast<int64_t>(Engine::get_singleton()->get_process_frames() - input_echo_start_frame);
+			++input_echo_samples;
+			input_echo_start_usec = 0;
+		}
+		if (!echo_wait_answered && echo_wait_skip_batch) {
+			echo_wait_skip_batch = false;
+		} else if (!echo_wait_answered && redraw_batch_touched_grid) {
+			echo_wait_answered = true;
+		}
+		redraw_batch_open = false;
+		redraw_batch_touched_grid = false;
+		_reconcile_predictive_echo();
+	} else if (p_event_name == "win_pos") {
+		_handle_win_pos(p_args_node);
+	} else if (p_event_name == "win_float_pos") {
+		_handle_win_float_pos(p_args_node);
+	} else if (p_event_name == "msg_set_pos") {
+		_handle_msg_set_pos(p_args_node);
+	} else if (p_event_name == "win_hide") {
+		_handle_win_hide(p_args_node, false);
+	} else if (p_event_name == "win_close") {
+		_handle_win_hide(p_args_node, true);
+	} else if (p_event_name == "win_viewport") {
+		_handle_win_viewport(p_args_node);
 	}
 }
 
@@ -551,8 +1469,9 @@ void NvimPanel::_handle_grid_resize(const mpack_node_t &p_args_node) {
 	for (int32_t row = 0; row < grid.rows; ++row) {
 		_fill_row(grid.cells[row]);
 	}
+	grid.mark_all_dirty();
 
-	if (grid_id == current_grid_id) {
+	if (grid_id == _get_main_grid_id()) {
 		grid_columns = grid.columns;
 		grid_rows = grid.rows;
 	}
@@ -578,6 +1497,7 @@ void NvimPanel::_handle_grid_clear(const mpack_node_t &p_args_node) {
 		std::vector<NvimCell> &row_cells = grid.cells[row];
 		_fill_row(row_cells);
 	}
+	grid.mark_all_dirty();
 
 	_request_grid_redraw();
 }
@@ -590,8 +1510,11 @@ void NvimPanel::_handle_grid_destroy(const mpack_node_t &p_args_node) {
 
 	int64_t grid_id = mpack_node_i64(mpack_node_array_at(p_args_node, 0));
 	grids.erase(grid_id);
+	grid_placements.erase(grid_id);
+	grid_toplines.erase(grid_id);
+	row_renderers.erase(grid_id);
 	if (grid_id == current_grid_id) {
-		current_grid_id = 0;
+		current_grid_id = multigrid_attached ? MULTIGRID_DEFAULT_GRID_ID : 0;
 		_ensure_grid(current_grid_id, grid_columns, grid_rows);
 	}
 
@@ -618,12 +1541,26 @@ void NvimPanel::_handle_grid_line(const mpack_node_t &p_args_node) {
 		return;
 	}
 
-	std::vector<NvimCell> &row_cells = grid.cells[static_cast<size_t>(row)];
-	int64_t write_column = column;
+	int64_t write_column = _write_grid_line_cells(grid.cells[static_cast<size_t>(row)], column, cells_node);
+
+	if (predictive_echo.has_predictions()) {
+		Time *time = Time::get_singleton();
+		predictive_echo.note_cells_updated(grid_id, row, column, write_column, time ? time->get_ticks_usec() : 0);
+	}
+
+	grid.mark_row_dirty(row);
+	_request_grid_redraw();
+}
+
+int64_t NvimPanel::_write_grid_line_cells(std::vector<NvimCell> &r_row, int64_t p_column, const mpack_node_t &p_cells_node) {
+	// Empty text is kept: it is the right half of a double-width character, which the
+	// renderers draw from the cell before it (NvimGrid::is_wide_cell).
+	int64_t columns = static_cast<int64_t>(r_row.size());
+	int64_t write_column = p_column;
 	int64_t last_hl_id = 0;
-	size_t cell_count = mpack_node_array_length(cells_node);
+	size_t cell_count = mpack_node_array_length(p_cells_node);
 	for (size_t cell_index = 0; cell_index < cell_count; ++cell_index) {
-		mpack_node_t cell_entry = mpack_node_array_at(cells_node, cell_index);
+		mpack_node_t cell_entry = mpack_node_array_at(p_cells_node, cell_index);
 		if (mpack_node_type(cell_entry) != mpack_type_array || mpack_node_array_length(cell_entry) == 0) {
 			continue;
 		}
@@ -631,9 +1568,6 @@ void NvimPanel::_handle_grid_line(const mpack_node_t &p_args_node) {
 		mpack_node_t text_node = mpack_node_array_at(cell_entry, 0);
 		size_t text_len = mpack_node_strlen(text_node);
 		String text = String::utf8(mpack_node_str(text_node), static_cast<int64_t>(text_len));
-		if (text.is_empty()) {
-			text = " ";
-		}
 
 		int64_t hl_id = last_hl_id;
 		if (mpack_node_array_length(cell_entry) >= 2) {
@@ -649,14 +1583,13 @@ void NvimPanel::_handle_grid_line(const mpack_node_t &p_args_node) {
 			repeat = std::max<int64_t>(1, mpack_node_i64(mpack_node_array_at(cell_entry, 2)));
 		}
 
-		for (int64_t r = 0; r < repeat && write_column < grid.columns; ++r, ++write_column) {
-			NvimCell &cell = row_cells[static_cast<size_t>(write_column)];
+		for (int64_t r = 0; r < repeat && write_column < columns; ++r, ++write_column) {
+			NvimCell &cell = r_row[static_cast<size_t>(write_column)];
 			cell.text = text;
 			cell.hl_id = hl_id;
 		}
 	}
-
-	_request_grid_redraw();
+	return write_column;
 }
 
 void NvimPanel::_handle_grid_cursor_goto(const mpack_node_t &p_args_node) {
@@ -665,13 +1598,298 @@ void NvimPanel::_handle_grid_cursor_goto(const mpack_node_t &p_args_node) {
 		return;
 	}
 
+	int64_t previous_drawn_grid_id = _get_drawn_grid_id();
 	current_grid_id = mpack_node_i64(mpack_node_array_at(p_args_node, 0));
 	cursor_row = mpack_node_i64(mpack_node_array_at(p_args_node, 1));
 	cursor_column = mpack_node_i64(mpack_node_array_at(p_args_node, 2));
 	_ensure_grid(current_grid_id, grid_columns, grid_rows);
+
+	// The grid draw list is untouched; only the cursor item moves.
+	cursor_overlay.move(cursor_row, cursor_column);
+	if (_get_drawn_grid_id() != previous_drawn_grid_id) {
+		_request_grid_redraw();
+	} else {
+		_update_cursor();
+	}
+}
+
+void NvimPanel::_handle_mode_info_set(const mpack_node_t &p_args_node) {
+	if (mpack_node_array_length(p_args_node) < 2) {
+		return;
+	}
+
+	bool style_enabled = mpack_node_bool(mpack_node_array_at(p_args_node, 0));
+	mpack_node_t mode_list = mpack_node_array_at(p_args_node, 1);
+	if (mpack_node_type(mode_list) != mpack_type_array) {
+		return;
+	}
+
+	std::vector<NvimCursorMode> modes;
+	size_t mode_count = mpack_node_array_length(mode_list);
+	modes.reserve(mode_count);
+	for (size_t mode_index = 0; mode_index < mode_count; ++mode_index) {
+		NvimCursorMode mode;
+		mpack_node_t mode_node = mpack_node_array_at(mode_list, mode_index);
+		if (mpack_node_type(mode_node) == mpack_type_map) {
+			size_t map_count = mpack_node_map_count(mode_node);
+			for (size_t i = 0; i < map_count; ++i) {
+				mpack_node_t key_node = mpack_node_map_key_at(mode_node, i);
+				mpack_node_t value_node = mpack_node_map_value_at(mode_node, i);
+				size_t key_len = mpack_node_strlen(key_node);
+				String key = String::utf8(mpack_node_str(key_node), static_cast<int64_t>(key_len));
+
+				mpack_type_t value_type = mpack_node_type(value_node);
+				bool is_integer = value_type == mpack_type_uint || value_type == mpack_type_int;
+				if (key == "cursor_shape" && value_type == mpack_type_str) {
+					String shape = String::utf8(mpack_node_str(value_node), static_cast<int64_t>(mpack_node_strlen(value_node)));
+					if (shape == "horizontal") {
+						mode.shape = NvimCursorMode::SHAPE_HORIZONTAL;
+					} else if (shape == "vertical") {
+						mode.shape = NvimCursorMode::SHAPE_VERTICAL;
+					} else {
+						mode.shape = NvimCursorMode::SHAPE_BLOCK;
+					}
+				} else if (key == "name" && value_type == mpack_type_str) {
+					mode.name = String::utf8(mpack_node_str(value_node), static_cast<int64_t>(mpack_node_strlen(value_node)));
+				} else if (key == "cell_percentage" && is_integer) {
+					mode.cell_percentage = static_cast<int32_t>(mpack_node_i64(value_node));
+				} else if (key == "blinkwait" && is_integer) {
+					mode.blinkwait = mpack_node_i64(value_node);
+				} else if (key == "blinkon" && is_integer) {
+					mode.blinkon = mpack_node_i64(value_node);
+				} else if (key == "blinkoff" && is_integer) {
+					mode.blinkoff = mpack_node_i64(value_node);
+				} else if (key == "attr_id" && is_integer) {
+					mode.attr_id = mpack_node_i64(value_node);
+				}
+			}
+		}
+		modes.push_back(mode);
+	}
+
+	cursor_overlay.set_modes(modes, style_enabled);
+	_update_cursor();
+}
+
+void NvimPanel::_handle_mode_change(const mpack_node_t &p_args_node) {
+	if (mpack_node_array_length(p_args_node) < 2) {
+		return;
+	}
+
+	mpack_node_t mode_node = mpack_node_array_at(p_args_node, 0);
+	if (mpack_node_type(mode_node) == mpack_type_str) {
+		nvim_mode_name = String::utf8(mpack_node_str(mode_node), static_cast<int64_t>(mpack_node_strlen(mode_node)));
+	}
+	cursor_overlay.set_mode(mpack_node_i64(mpack_node_array_at(p_args_node, 1)));
+	// Predictions only hold for plain insert mode; an insert mapping such as jk -> <Esc>
+	// is noticed here.
+	if (nvim_mode_name != "insert" && predictive_echo.rollback()) {
+		_update_predictive_echo();
+		return;
+	}
+	_update_cursor();
+}
+
+void NvimPanel::_handle_win_pos(const mpack_node_t &p_args_node) {
+	if (mpack_node_array_length(p_args_node) < 4) {
+		return;
+	}
+
+	int64_t grid_id = mpack_node_i64(mpack_node_array_at(p_args_node, 0));
+	NvimGridPlacement &placement = grid_placements[grid_id];
+	placement.row = static_cast<int32_t>(mpack_node_i64(mpack_node_array_at(p_args_node, 2)));
+	placement.column = static_cast<int32_t>(mpack_node_i64(mpack_node_array_at(p_args_node, 3)));
+	placement.zindex = 0;
+	placement.floating = false;
+	placement.visible = true;
+	_request_grid_redraw();
+}
+
+void NvimPanel::_handle_win_float_pos(const mpack_node_t &p_args_node) {
+	size_t arg_len = mpack_node_array_length(p_args_node);
+	if (arg_len < 6) {
+		return;
+	}
+
+	int64_t grid_id = mpack_node_i64(mpack_node_array_at(p_args_node, 0));
+	mpack_node_t anchor_node = mpack_node_array_at(p_args_node, 2);
+	String anchor = String::utf8(mpack_node_str(anchor_node), static_cast<int64_t>(mpack_node_strlen(anchor_node)));
+	int64_t anchor_grid = mpack_node_i64(mpack_node_array_at(p_args_node, 3));
+	double row = mpack_node_double(mpack_node_array_at(p_args_node, 4));
+	double column = mpack_node_double(mpack_node_array_at(p_args_node, 5));
+	int64_t zindex = arg_len >= 8 ? mpack_node_i64(mpack_node_array_at(p_args_node, 7)) : 50;
+
+	auto anchor_it = grid_placements.find(anchor_grid);
+	if (anchor_grid != MULTIGRID_DEFAULT_GRID_ID && anchor_it != grid_placements.end()) {
+		row += anchor_it->second.row;
+		column += anchor_it->second.column;
+	}
+
+	// The anchor names the float's corner that sits on (row, column).
+	auto grid_it = grids.find(grid_id);
+	if (grid_it != grids.end()) {
+		if (anchor.length() > 0 && anchor[0] == 'S') {
+			row -= grid_it->second.rows;
+		}
+		if (anchor.length() > 1 && anchor[1] == 'E') {
+			column -= grid_it->second.columns;
+		}
+	}
+
+	NvimGridPlacement &placement = grid_placements[grid_id];
+	placement.row = std::max(0, static_cast<int32_t>(std::floor(row)));
+	placement.column = std::max(0, static_cast<int32_t>(std::floor(column)));
+	placement.zindex = static_cast<int32_t>(zindex);
+	placement.floating = true;
+	placement.visible = true;
+	_request_grid_redraw();
+}
+
+void NvimPanel::_handle_msg_set_pos(const mpack_node_t &p_args_node) {
+	size_t arg_len = mpack_node_array_length(p_args_node);
+	if (arg_len < 2) {
+		return;
+	}
+
+	int64_t grid_id = mpack_node_i64(mpack_node_array_at(p_args_node, 0));
+	NvimGridPlacement &placement = grid_placements[grid_id];
+	placement.row = static_cast<int32_t>(mpack_node_i64(mpack_node_array_at(p_args_node, 1)));
+	placement.column = 0;
+	placement.zindex = arg_len >= 5 ? static_cast<int32_t>(mpack_node_i64(mpack_node_array_at(p_args_node, 4))) : 200;
+	placement.floating = true;
+	placement.visible = true;
 	_request_grid_redraw();
 }
 
+void NvimPanel::_handle_win_hide(const mpack_node_t &p_args_node, bool p_close) {
+	if (mpack_node_array_length(p_args_node) < 1) {
+		return;
+	}
+
+	int64_t grid_id = mpack_node_i64(mpack_node_array_at(p_args_node, 0));
+	if (p_close) {
+		grid_placements.erase(grid_id);
+	} else {
+		auto it = grid_placements.find(grid_id);
+		if (it != grid_placements.end()) {
+			it->second.visible = false;
+		}
+	}
+	_request_grid_redraw();
+}
+
+void NvimPanel::_handle_win_viewport(const mpack_node_t &p_args_node) {
+	size_t arg_len = mpack_node_array_length(p_args_node);
+	if (arg_len < 3) {
+		return;
+	}
+
+	int64_t grid_id = mpack_node_i64(mpack_node_array_at(p_args_node, 0));
+	int64_t topline = mpack_node_i64(mpack_node_array_at(p_args_node, 2));
+	int64_t scroll_delta = 0;
+	if (arg_len >= 8) {
+		scroll_delta = mpack_node_i64(mpack_node_array_at(p_args_node, 7));
+	} else {
+		auto previous = grid_toplines.find(grid_id);
+		if (previous != grid_toplines.end()) {
+			scroll_delta = topline - previous->second;
+		}
+	}
+	grid_toplines[grid_id] = topline;
+
+	// Only a moved viewport slides; grid_scroll from inserting or deleting lines does not.
+	if (scroll_delta == 0 || smooth_scroll_time <= 0.0) {
+		return;
+	}
+	auto renderer_it = row_renderers.find(grid_id);
+	if (renderer_it != row_renderers.end()) {
+		renderer_it->second->animate_pending_scroll(smooth_scroll_time);
+	}
+}
+
+void NvimPanel::_update_cursor() {
+	if (!grid_canvas) {
+		return;
+	}
+
+	// While characters are predicted the cursor is shown after the last one.
+	int64_t column = predictive_echo.has_predictions() ? predictive_echo.get_cursor_column() : cursor_column;
+	const NvimCell *cell = nullptr;
+	Vector2 grid_origin;
+	const NvimGrid *grid = _get_shown_grid(current_grid_id, grid_origin);
+	auto renderer_it = multigrid_attached ? row_renderers.find(current_grid_id) : row_renderers.end();
+	if (grid && renderer_it != row_renderers.end()) {
+		// Ride along with a window that is still sliding after a scroll.
+		grid_origin.y += renderer_it->second->get_row_offset(static_cast<int32_t>(cursor_row));
+	}
+	if (grid && cursor_row >= 0 && column >= 0 && static_cast<size_t>(cursor_row) < grid->cells.size()) {
+		const std::vector<NvimCell> &row_cells = grid->cells[static_cast<size_t>(cursor_row)];
+		if (static_cast<size_t>(column) < row_cells.size()) {
+			cell = &row_cells[static_cast<size_t>(column)];
+		}
+	}
+	cursor_overlay.update(grid_canvas->get_canvas_item(), &font_cache, cell, palette, grid_origin);
+}
+
+const NvimGrid *NvimPanel::_get_shown_grid(int64_t p_grid_id, Vector2 &r_origin) const {
+	int32_t draw_index = 0;
+	bool grid_shown = multigrid_attached ? _get_grid_placement(p_grid_id, r_origin, draw_index) : p_grid_id == _get_drawn_grid_id();
+	if (!grid_shown) {
+		return nullptr;
+	}
+	auto it = grids.find(p_grid_id);
+	return it != grids.end() ? &it->second : nullptr;
+}
+
+void NvimPanel::_predict_key(char32_t p_unicode, uint8_t p_modifiers) {
+	if (!predictive_echo_setting) {
+		return;
+	}
+
+	// Wide and combining characters, chords and special keys are left to Neovim.
+	bool printable = p_unicode >= 32 && p_unicode != 127 && p_unicode < 0x300 && (p_modifiers & (NvimKeyNotation::MOD_CTRL | NvimKeyNotation::MOD_ALT)) == 0;
+	if (!printable || nvim_mode_name != "insert") {
+		predictive_echo.invalidate();
+		return;
+	}
+
+	auto it = grids.find(current_grid_id);
+	if (it == grids.end()) {
+		return;
+	}
+	Time *time = Time::get_singleton();
+	uint64_t now_usec = time ? time->get_ticks_usec() : 0;
+	if (predictive_echo.predict(current_grid_id, cursor_row, cursor_column, it->second.columns, p_unicode, now_usec)) {
+		_update_predictive_echo();
+	}
+}
+
+void NvimPanel::_reconcile_predictive_echo() {
+	if (!predictive_echo.has_predictions()) {
+		predictive_echo.reconcile(nullptr, current_grid_id, cursor_row, 0);
+		return;
+	}
+
+	auto it = grids.find(predictive_echo.get_grid_id());
+	Time *time = Time::get_singleton();
+	predictive_echo.reconcile(it != grids.end() ? &it->second : nullptr, current_grid_id, cursor_row, time ? time->get_ticks_usec() : 0);
+	// grid_cursor_goto moved the cursor to Neovim's position; put it back after any
+	// predictions that are still pending.
+	_update_predictive_echo();
+}
+
+void NvimPanel::_update_predictive_echo() {
+	if (!grid_canvas) {
+		return;
+	}
+
+	Vector2 grid_origin;
+	const NvimGrid *grid = predictive_echo.has_predictions() ? _get_shown_grid(predictive_echo.get_grid_id(), grid_origin) : nullptr;
+	predictive_echo.update(grid_canvas->get_canvas_item(), &font_cache, grid, palette, grid_origin);
+	cursor_overlay.move(cursor_row, predictive_echo.has_predictions() ? predictive_echo.get_cursor_column() : cursor_column);
+	_update_cursor();
+}
+
 void NvimPanel::_handle_grid_scroll(const mpack_node_t &p_args_node) {
 	size_t arg_len = mpack_node_array_length(p_args_node);
 	if (arg_len < 7) {
@@ -693,6 +1911,13 @@ void NvimPanel::_handle_grid_scroll(const mpack_node_t &p_args_node) {
 		return;
 	}
 
+	bool translated = false;
+	auto renderer_it = row_renderers.find(grid_id);
+	bool renderer_active = multigrid_attached || (renderer_setting == "canvas" && grid_id == _get_drawn_grid_id());
+	if (renderer_it != row_renderers.end() && renderer_active && left <= 0 && right >= grid.columns && cols == 0) {
+		translated = renderer_it->second->scroll(static_cast<int32_t>(top), static_cast<int32_t>(bottom), static_cast<int32_t>(rows));
+	}
+
 	std::vector<std::vector<NvimCell>> region(static_cast<size_t>(height), std::vector<NvimCell>(static_cast<size_t>(width)));
 	for (int64_t r = 0; r < height; ++r) {
 		int64_t grid_row = top + r;
@@ -733,10 +1958,25 @@ void NvimPanel::_handle_grid_scroll(const mpack_node_t &p_args_node) {
 		}
 	}
 
+	if (translated) {
+		// Dirty flags travel with the row items; only the exposed rows need recording.
+		if (grid.dirty_rows.size() == static_cast<size_t>(grid.rows)) {
+			auto first = grid.dirty_rows.begin() + top;
+			auto last = grid.dirty_rows.begin() + bottom;
+			std::rotate(first, rows > 0 ? first + rows : last + rows, last);
+		}
+		if (rows > 0) {
+			grid.mark_rows_dirty(bottom - rows, bottom);
+		} else {
+			grid.mark_rows_dirty(top, top - rows);
+		}
+	} else {
+		grid.mark_rows_dirty(top, bottom);
+	}
 	_request_grid_redraw();
 }
 
-NvimPanel::NvimGrid &NvimPanel::_ensure_grid(int64_t p_grid_id, int32_t p_columns, int32_t p_rows) {
+NvimGrid &NvimPanel::_ensure_grid(int64_t p_grid_id, int32_t p_columns, int32_t p_rows) {
 	NvimGrid &grid = grids[p_grid_id];
 	if (p_columns <= 0) {
 		p_columns = grid.columns > 0 ? grid.columns : grid_columns;
@@ -754,6 +1994,7 @@ NvimPanel::NvimGrid &NvimPanel::_ensure_grid(int64_t p_grid_id, int32_t p_column
 			row_cells.resize(static_cast<size_t>(grid.columns));
 			_fill_row(row_cells);
 		}
+		grid.mark_all_dirty();
 	}
 
 	return grid;
@@ -772,12 +2013,13 @@ void NvimPanel::_handle_hl_attr_define(const mpack_node_t &p_args_node) {
 	}
 
 	int64_t hl_id = mpack_node_i64(mpack_node_array_at(p_args_node, 0));
-	Highlight &highlight = highlight_definitions[hl_id];
+	NvimHighlight &highlight = palette.highlights[hl_id];
 
 	mpack_node_t rgb_attrs = mpack_node_array_at(p_args_node, 1);
 	if (mpack_node_type(rgb_attrs) == mpack_type_map) {
 		size_t map_count = mpack_node_map_count(rgb_attrs);
 		bool reverse = false;
+		uint32_t attributes = 0;
 		Color fg = highlight.foreground;
 		Color bg = highlight.background;
 		bool fg_set = highlight.has_foreground;
@@ -800,6 +2042,14 @@ void NvimPanel::_handle_hl_attr_define(const mpack_node_t &p_args_node) {
 				bg_set = true;
 			} else if (key == "reverse" && value_type == mpack_type_bool) {
 				reverse = mpack_node_bool(value_node);
+			} else if (value_type == mpack_type_bool && mpack_node_bool(value_node)) {
+				if (key == "underline" || key == "underdouble" || key == "underdotted" || key == "underdashed") {
+					attributes |= NVIM_HL_UNDERLINE;
+				} else if (key == "undercurl") {
+					attributes |= NVIM_HL_UNDERCURL;
+				} else if (key == "strikethrough") {
+					attributes |= NVIM_HL_STRIKETHROUGH;
+				}
 			}
 		}
 
@@ -816,8 +2066,10 @@ void NvimPanel::_handle_hl_attr_define(const mpack_node_t &p_args_node) {
 		highlight.background = bg;
 		highlight.has_foreground = fg_set;
 		highlight.has_background = bg_set;
+		highlight.attributes = attributes;
 	}
 
+	_mark_all_grids_dirty();
 	_request_grid_redraw();
 }
 
@@ -841,13 +2093,14 @@ void NvimPanel::_handle_default_colors_set(const mpack_node_t &p_args_node) {
 		if ((value_type == mpack_type_uint || value_type == mpack_type_int)) {
 			int64_t color_value = mpack_node_i64(value_node);
 			if (key == "foreground") {
-				default_foreground = _color_from_rgb_value(color_value);
+				palette.default_foreground = _color_from_rgb_value(color_value);
 			} else if (key == "background") {
-				default_background = _color_from_rgb_value(color_value);
+				palette.default_background = _color_from_rgb_value(color_value);
 			}
 		}
 	}
 
+	_mark_all_grids_dirty();
 	_request_grid_redraw();
 }
 
@@ -863,158 +2116,195 @@ Color NvimPanel::_color_from_rgb_value(int64_t p_value) const {
 }
 
 Color NvimPanel::_resolve_foreground(int64_t p_hl_id) const {
-	auto it = highlight_definitions.find(p_hl_id);
-	if (it != highlight_definitions.end() && it->second.has_foreground) {
-		return it->second.foreground;
-	}
-	return default_foreground;
+	return palette.resolve_foreground(p_hl_id);
 }
 
 Color NvimPanel::_resolve_background(int64_t p_hl_id) const {
-	auto it = highlight_definitions.find(p_hl_id);
-	if (it != highlight_definitions.end() && it->second.has_background) {
-		return it->second.background;
-	}
-	return default_background;
+	return palette.resolve_background(p_hl_id);
 }
 
-Ref<Font> NvimPanel::_obtain_font() const {
-	if (cached_font.is_valid()) {
-		return cached_font;
+void NvimPanel::_draw_grid(NvimGridCanvas *p_canvas) {
+	if (!p_canvas) {
+		return;
 	}
 
-	ResourceLoader *loader = ResourceLoader::get_singleton();
-	String font_path = font_path_setting.is_empty() ? _get_default_font_path() : font_path_setting;
-	if (loader && !font_path.is_empty()) {
-		Ref<Resource> font_res = loader->load(font_path);
-		Ref<Font> custom_font = font_res;
-		if (custom_font.is_valid()) {
-			cached_font = custom_font;
-			return cached_font;
+	if (first_frame_flushed) {
+		first_frame_flushed = false;
+		Time *time = Time::get_singleton();
+		time_to_first_frame_usec = static_cast<int64_t>((time ? time->get_ticks_usec() : 0) - nvim_start_usec);
+		if (debug_logging_enabled) {
+			UtilityFunctions::print("[nvim_embed] First frame painted ", time_to_first_frame_usec / 1000, " ms after start at ", grid_columns, "x", grid_rows, ".");
 		}
 	}
 
-	ThemeDB *theme_db = ThemeDB::get_singleton();
-	Ref<Theme> theme;
-	if (theme_db) {
-		theme = theme_db->get_project_theme();
-		if (!theme.is_valid()) {
-			theme = theme_db->get_default_theme();
-		}
+	if (multigrid_attached) {
+		_draw_multigrid(p_canvas);
+		return;
 	}
 
-	if (theme.is_valid()) {
-		Ref<Font> theme_font = theme->get_font(StringName("font"), StringName("Label"));
-		if (theme_font.is_valid()) {
-			cached_font = theme_font;
-			return cached_font;
+	auto grid_it = grids.find(current_grid_id);
+	if (grid_it == grids.end()) {
+		if (grids.empty()) {
+			return;
 		}
+		grid_it = grids.begin();
 	}
 
-	if (theme_db) {
-		Ref<Font> fallback_font = theme_db->get_fallback_font();
-		if (fallback_font.is_valid()) {
-			cached_font = fallback_font;
-			return cached_font;
-		}
+	NvimGrid &grid = grid_it->second;
+	if (grid.columns <= 0 || grid.rows <= 0) {
+		return;
 	}
 
-	return Ref<Font>();
-}
+	if (font_cache.get_font().is_null()) {
+		return;
+	}
+	_ensure_cell_metrics();
 
-int32_t NvimPanel::_obtain_font_size() const {
-	ThemeDB *theme_db = ThemeDB::get_singleton();
-	Ref<Theme> theme;
-	if (theme_db) {
-		theme = theme_db->get_project_theme();
-		if (!theme.is_valid()) {
-			theme = theme_db->get_default_theme();
-		}
+	if (grid_it->first != last_drawn_grid_id) {
+		last_drawn_grid_id = grid_it->first;
+		grid.mark_all_dirty();
 	}
 
-	if (theme.is_valid()) {
-		int32_t theme_size = theme->get_font_size(StringName("font_size"), StringName("Label"));
-		if (theme_size > 0) {
-			return theme_size;
+	Vector2 canvas_size = p_canvas->get_size();
+	p_canvas->draw_rect(Rect2(Vector2(), canvas_size), palette.default_background, true);
+
+	if (renderer_setting == "gpu") {
+		if (!gpu_renderer) {
+			gpu_renderer = std::make_unique<NvimGpuRenderer>();
 		}
+		_release_row_renderers(-1);
+		gpu_renderer->configure(&font_cache);
+		gpu_renderer->draw(p_canvas->get_canvas_item(), grid, palette);
+		grid.clear_dirty();
+		_update_cursor();
+		return;
 	}
 
-	if (theme_db) {
-		int32_t fallback_size = theme_db->get_fallback_font_size();
-		if (fallback_size > 0) {
-			return fallback_size;
-		}
+	if (gpu_renderer) {
+		gpu_renderer->release();
+		gpu_renderer.reset();
 	}
 
-	return font_size;
+	_release_row_renderers(grid_it->first);
+	_configure_row_texture_cache();
+	_draw_grid_rows(p_canvas, grid_it->first, grid, Vector2(), 0);
+	_update_cursor();
 }
 
-void NvimPanel::_draw_grid(NvimGridCanvas *p_canvas) {
-	if (!p_canvas) {
+void NvimPanel::_draw_multigrid(NvimGridCanvas *p_canvas) {
+	if (font_cache.get_font().is_null()) {
 		return;
 	}
+	_ensure_cell_metrics();
 
-	auto grid_it = grids.find(current_grid_id);
-	if (grid_it == grids.end()) {
-		if (grids.empty()) {
-			return;
+	Vector2 canvas_size = p_canvas->get_size();
+	p_canvas->draw_rect(Rect2(Vector2(), canvas_size), palette.default_background, true);
+
+	// ext_multigrid is only attached for the canvas renderer; every window grid gets its
+	// own row renderer placed and layered where Neovim positioned the window.
+	if (gpu_renderer) {
+		gpu_renderer->release();
+		gpu_renderer.reset();
+	}
+
+	for (auto it = row_renderers.begin(); it != row_renderers.end();) {
+		if (grids.find(it->first) == grids.end()) {
+			it = row_renderers.erase(it);
+		} else {
+			++it;
 		}
-		grid_it = grids.begin();
 	}
 
-	const NvimGrid &grid = grid_it->second;
-	if (grid.columns <= 0 || grid.rows <= 0) {
-		return;
+	_configure_row_texture_cache();
+	for (auto &entry : grids) {
+		NvimGrid &grid = entry.second;
+		Vector2 origin;
+		int32_t draw_index = 0;
+		if (grid.columns <= 0 || grid.rows <= 0 || !_get_grid_placement(entry.first, origin, draw_index)) {
+			auto renderer_it = row_renderers.find(entry.first);
+			if (renderer_it != row_renderers.end()) {
+				renderer_it->second->set_placement(origin, draw_index, false);
+			}
+			continue;
+		}
+		_draw_grid_rows(p_canvas, entry.first, grid, origin, draw_index);
 	}
+	_update_cursor();
+}
 
-	Ref<Font> font = _obtain_font();
-	if (font.is_null()) {
-		return;
+void NvimPanel::_draw_grid_rows(NvimGridCanvas *p_canvas, int64_t p_grid_id, NvimGrid &p_grid, const Vector2 &p_origin, int32_t p_draw_index) {
+	std::unique_ptr<NvimRowRenderer> &renderer = row_renderers[p_grid_id];
+	if (!renderer) {
+		renderer = std::make_unique<NvimRowRenderer>();
 	}
+	renderer->configure(&font_cache);
+	renderer->set_texture_cache(row_texture_cache.get());
+	renderer->set_smooth_scroll(multigrid_attached && smooth_scroll_time > 0.0);
+	renderer->set_prepare_tasks(row_prepare_tasks);
+	renderer->draw(p_canvas->get_canvas_item(), p_grid, palette);
+	renderer->set_placement(p_origin, p_draw_index, true);
+	p_grid.clear_dirty();
+}
 
-	int32_t size = _obtain_font_size();
-	Vector2 char_size = font->get_char_size(U'M', size);
-	float cell_w = char_size.x;
-	if (cell_w <= 0) {
-		char_size = font->get_char_size(U' ', size);
-		cell_w = char_size.x;
+void NvimPanel::_configure_row_texture_cache() {
+	if (row_texture_cache_limit > 0) {
+		if (!row_texture_cache) {
+			row_texture_cache = std::make_unique<NvimRowTextureCache>();
+		}
+		row_texture_cache->configure(&font_cache);
+		row_texture_cache->set_memory_limit(row_texture_cache_limit);
+	} else if (row_texture_cache) {
+		for (auto &entry : row_renderers) {
+			entry.second->set_texture_cache(nullptr);
+		}
+		row_texture_cache.reset();
 	}
-	if (cell_w <= 0) {
-		cell_w = font->get_height(size) * 0.6f;
+}
+
+void NvimPanel::_release_row_renderers(int64_t p_keep_grid_id) {
+	for (auto it = row_renderers.begin(); it != row_renderers.end();) {
+		if (it->first != p_keep_grid_id) {
+			it = row_renderers.erase(it);
+		} else {
+			++it;
+		}
 	}
-	float cell_h = font->get_height(size);
-	float ascent = font->get_ascent(size);
-	cell_width = cell_w > 0 ? cell_w : 1.0f;
-	cell_height = cell_h > 0 ? cell_h : 1.0f;
-	cell_ascent = ascent >= 0 ? ascent : cell_height * 0.8f;
+}
 
-	Vector2 canvas_size = p_canvas->get_size();
-	p_canvas->draw_rect(Rect2(Vector2(), canvas_size), default_background, true);
+bool NvimPanel::_get_grid_placement(int64_t p_grid_id, Vector2 &r_origin, int32_t &r_draw_index) const {
+	r_origin = Vector2();
+	r_draw_index = 0;
+	if (p_grid_id == MULTIGRID_DEFAULT_GRID_ID) {
+		return true;
+	}
 
-	for (int32_t row = 0; row < grid.rows; ++row) {
-		if (static_cast<size_t>(row) >= grid.cells.size()) {
-			break;
-		}
-		const std::vector<NvimCell> &row_cells = grid.cells[static_cast<size_t>(row)];
-		for (int32_t col = 0; col < grid.columns && static_cast<size_t>(col) < row_cells.size(); ++col) {
-			const NvimCell &cell = row_cells[static_cast<size_t>(col)];
-			Vector2 cell_position(static_cast<float>(col) * cell_w, static_cast<float>(row) * cell_h);
+	auto it = grid_placements.find(p_grid_id);
+	if (it == grid_placements.end() || !it->second.visible) {
+		return false;
+	}
 
-			Color bg = _resolve_background(cell.hl_id);
-			if (grid_it->first == current_grid_id && row == cursor_row && col == cursor_column) {
-				bg = bg.lightened(0.3f);
-			}
-			if (bg.a > 0.0f) {
-				p_canvas->draw_rect(Rect2(cell_position, Vector2(cell_w, cell_h)), bg, true);
-			}
+	// The default grid stays at index 0, split windows above it and floats by zindex.
+	const NvimGridPlacement &placement = it->second;
+	r_origin = Vector2(cell_width * placement.column, cell_height * placement.row);
+	r_draw_index = placement.floating ? 2 + placement.zindex : 1;
+	return true;
+}
 
-			Color fg = _resolve_foreground(cell.hl_id);
-			Vector2 text_position(cell_position.x, cell_position.y + cell_ascent);
-			p_canvas->draw_string(font, text_position, cell.text, HORIZONTAL_ALIGNMENT_LEFT, -1.0, size, fg);
-		}
+int64_t NvimPanel::_get_main_grid_id() const {
+	return multigrid_attached ? MULTIGRID_DEFAULT_GRID_ID : current_grid_id;
+}
+
+int64_t NvimPanel::_get_drawn_grid_id() const {
+	if (grids.find(current_grid_id) != grids.end() || grids.empty()) {
+		return current_grid_id;
 	}
+	return grids.begin()->first;
+}
 
-	_sync_neovim_size_to_canvas();
+void NvimPanel::_mark_all_grids_dirty() {
+	for (auto &entry : grids) {
+		entry.second.mark_all_dirty();
+	}
 }
 
 void NvimPanel::_update_canvas_size() {
@@ -1028,9 +2318,56 @@ void NvimPanel::_update_canvas_size() {
 }
 
 void NvimPanel::_request_grid_redraw() {
-	if (grid_canvas) {
-		grid_canvas->queue_redraw();
+	// Redraws are only flagged here; _present_pending_frame() repaints at most once per
+	// frame interval and everything that arrived in between lands in that one frame.
+	redraw_pending = true;
+}
+
+void NvimPanel::_present_pending_frame() {
+	Time *time = Time::get_singleton();
+	uint64_t now_usec = time ? time->get_ticks_usec() : 0;
+
+	if (now_usec - frame_stats_window_start_usec >= 1000000) {
+		frames_presented_per_second = frames_presented_window;
+		frames_coalesced_per_second = frames_coalesced_window;
+		frames_presented_window = 0;
+		frames_coalesced_window = 0;
+		frame_stats_window_start_usec = now_usec;
+	}
+
+	if (!redraw_pending || !grid_canvas) {
+		return;
+	}
+	if (frame_interval_usec > 0) {
+		if (now_usec < next_frame_present_usec) {
+			++frames_coalesced_window;
+			return;
+		}
+		// The deadline advances by whole intervals so frame jitter does not drop the rate;
+		// after an idle stretch or a stall it restarts from now.
+		next_frame_present_usec += frame_interval_usec;
+		if (next_frame_present_usec <= now_usec) {
+			next_frame_present_usec = now_usec + frame_interval_usec;
+		}
+	}
+
+	redraw_pending = false;
+	++frames_presented_window;
+	grid_canvas->queue_redraw();
+}
+
+uint64_t NvimPanel::_compute_frame_interval_usec(int32_t p_max_fps) const {
+	// _process already runs at most once per displayed frame, so a cap at or above the
+	// refresh rate would only drop frames; pacing is off in that case.
+	if (p_max_fps <= 0) {
+		return 0;
+	}
+	DisplayServer *display = DisplayServer::get_singleton();
+	double refresh_rate = display ? display->screen_get_refresh_rate() : -1.0;
+	if (refresh_rate > 0.0 && p_max_fps >= refresh_rate) {
+		return 0;
 	}
+	return static_cast<uint64_t>(1000000.0 / p_max_fps);
 }
 
 bool NvimPanel::_handle_gui_input(const Ref<InputEvent> &p_event) {
@@ -1057,6 +2394,14 @@ bool NvimPanel::_handle_gui_input(const Ref<InputEvent> &p_event) {
 		return _handle_mouse_motion_event(mouse_motion_event);
 	}
 
+	Ref<InputEventPanGesture> pan_gesture_event = p_event;
+	if (pan_gesture_event.is_valid()) {
+		++mouse_events_received;
+		Vector2 delta = pan_gesture_event->get_delta();
+		_queue_wheel(delta.x / PAN_DELTA_PER_WHEEL_STEP, delta.y / PAN_DELTA_PER_WHEEL_STEP, pan_gesture_event->get_position(), pan_gesture_event->is_shift_pressed(), pan_gesture_event->is_ctrl_pressed(), pan_gesture_event->is_alt_pressed());
+		return true;
+	}
+
 	return false;
 }
 
@@ -1069,12 +2414,15 @@ bool NvimPanel::_handle_key_event(const Ref<InputEventKey> &p_key_event) {
 		return false;
 	}
 
-	String translated = _translate_key_event(p_key_event);
-	if (translated.is_empty()) {
-		return false;
+	if (p_key_event->get_keycode() == Key::KEY_V && p_key_event->is_ctrl_pressed() && p_key_event->is_shift_pressed() && !p_key_event->is_alt_pressed()) {
+		DisplayServer *display_server = DisplayServer::get_singleton();
+		return display_server && _start_paste(display_server->clipboard_get());
 	}
 
-	if (_send_nvim_input(translated)) {
+	Key keycode = static_cast<Key>(p_key_event->get_keycode());
+	uint8_t modifiers = NvimKeyNotation::modifiers(p_key_event->is_shift_pressed(), p_key_event->is_ctrl_pressed(), p_key_event->is_alt_pressed());
+	if (_queue_key_event(keycode, p_key_event->get_unicode(), modifiers)) {
+		_predict_key(p_key_event->get_unicode(), modifiers);
 		if (grid_canvas) {
 			grid_canvas->grab_focus();
 		}
@@ -1100,27 +2448,14 @@ bool NvimPanel::_handle_mouse_button_event(const Ref<InputEventMouseButton> &p_m
 		if (!pressed) {
 			return false;
 		}
+		++mouse_events_received;
 
-		String base;
-		switch (button_index) {
-			case MouseButton::MOUSE_BUTTON_WHEEL_UP:
-				base = "ScrollWheelUp";
-				break;
-			case MouseButton::MOUSE_BUTTON_WHEEL_DOWN:
-				base = "ScrollWheelDown";
-				break;
-			case MouseButton::MOUSE_BUTTON_WHEEL_LEFT:
-				base = "ScrollWheelLeft";
-				break;
-			case MouseButton::MOUSE_BUTTON_WHEEL_RIGHT:
-				base = "ScrollWheelRight";
-				break;
-			default:
-				return false;
-		}
-
-		String seq = _format_special_key(base, p_mouse_event->is_shift_pressed(), p_mouse_event->is_ctrl_pressed(), p_mouse_event->is_alt_pressed());
-		return _send_nvim_input(seq);
+		// Precise devices report fractional ticks in factor; 0 means the device has none.
+		double steps = p_mouse_event->get_factor() > 0.0 ? p_mouse_event->get_factor() : 1.0;
+		double delta_x = button_index == MouseButton::MOUSE_BUTTON_WHEEL_LEFT ? -steps : (button_index == MouseButton::MOUSE_BUTTON_WHEEL_RIGHT ? steps : 0.0);
+		double delta_y = button_index == MouseButton::MOUSE_BUTTON_WHEEL_UP ? -steps : (button_index == MouseButton::MOUSE_BUTTON_WHEEL_DOWN ? steps : 0.0);
+		_queue_wheel(delta_x, delta_y, p_mouse_event->get_position(), p_mouse_event->is_shift_pressed(), p_mouse_event->is_ctrl_pressed(), p_mouse_event->is_alt_pressed());
+		return true;
 	}
 
 	String button_name;
@@ -1138,138 +2473,257 @@ bool NvimPanel::_handle_mouse_button_event(const Ref<InputEventMouseButton> &p_m
 			return false;
 	}
 
+	++mouse_events_received;
 	String action = pressed ? "press" : "release";
 	int64_t row = 0;
 	int64_t column = 0;
 	_convert_position_to_cell(p_mouse_event->get_position(), row, column);
 	String modifiers = _build_modifier_string(p_mouse_event->is_shift_pressed(), p_mouse_event->is_ctrl_pressed(), p_mouse_event->is_alt_pressed());
 
-	return _send_nvim_input_mouse(button_name, action, modifiers, current_grid_id, row, column);
-}
+	int64_t grid_id = current_grid_id;
+	_find_grid_at(row, column, grid_id, row, column);
 
-bool NvimPanel::_handle_mouse_motion_event(const Ref<InputEventMouseMotion> &p_motion_event) {
-	if (p_motion_event.is_null()) {
-		return false;
+	if (button_index == MouseButton::MOUSE_BUTTON_MIDDLE && modifiers.is_empty()) {
+		// Middle-click pastes the primary selection (the clipboard where there is none) at
+		// the clicked cell: a left click places the cursor, then the text is streamed.
+		if (!pressed) {
+			return true;
+		}
+		DisplayServer *display_server = DisplayServer::get_singleton();
+		if (!display_server) {
+			return false;
+		}
+		String text = display_server->has_feature(DisplayServer::FEATURE_CLIPBOARD_PRIMARY) ? display_server->clipboard_get_primary() : display_server->clipboard_get();
+		if (text.is_empty()) {
+			return true;
+		}
+		_send_nvim_input_mouse("left", "press", modifiers, grid_id, row, column);
+		_send_nvim_input_mouse("left", "release", modifiers, grid_id, row, column);
+		return _start_paste(text);
 	}
 
-	int32_t mask = p_motion_event->get_button_mask();
-	String button_name;
-	if (mask & static_cast<int32_t>(MouseButtonMask::MOUSE_BUTTON_MASK_LEFT)) {
-		button_name = "left";
-	} else if (mask & static_cast<int32_t>(MouseButtonMask::MOUSE_BUTTON_MASK_RIGHT)) {
-		button_name = "right";
-	} else if (mask & static_cast<int32_t>(MouseButtonMask::MOUSE_BUTTON_MASK_MIDDLE)) {
-		button_name = "middle";
-	} else {
-		return false;
+	// A drag that stays in the pressed cell tells Neovim nothing new.
+	drag_button = pressed ? button_name : String();
+	drag_grid_id = grid_id;
+	drag_row = row;
+	drag_column = column;
+	return _send_nvim_input_mouse(button_name, action, modifiers, grid_id, row, column);
+}
+
+void NvimPanel::_queue_wheel(double p_delta_x, double p_delta_y, const Vector2 &p_position, bool p_shift, bool p_ctrl, bool p_alt) {
+	String modifiers = _build_modifier_string(p_shift, p_ctrl, p_alt);
+	if (wheel_pending && modifiers != wheel_modifiers) {
+		_flush_pending_wheel();
+	}
+	// Turning back drops the fraction left over from the other direction.
+	if ((p_delta_x > 0.0 && wheel_delta_x < 0.0) || (p_delta_x < 0.0 && wheel_delta_x > 0.0)) {
+		wheel_delta_x = 0.0;
+	}
+	if ((p_delta_y > 0.0 && wheel_delta_y < 0.0) || (p_delta_y < 0.0 && wheel_delta_y > 0.0)) {
+		wheel_delta_y = 0.0;
 	}
+	wheel_delta_x += p_delta_x;
+	wheel_delta_y += p_delta_y;
+	wheel_modifiers = modifiers;
+	wheel_shift = p_shift;
+	wheel_ctrl = p_ctrl;
+	wheel_alt = p_alt;
+	wheel_position = p_position;
+	wheel_pending = true;
+}
 
-	int64_t row = 0;
-	int64_t column = 0;
-	_convert_position_to_cell(p_motion_event->get_position(), row, column);
-	String modifiers = _build_modifier_string(p_motion_event->is_shift_pressed(), p_motion_event->is_ctrl_pressed(), p_motion_event->is_alt_pressed());
+void NvimPanel::_flush_pending_wheel() {
+	if (!wheel_pending) {
+		return;
+	}
+	wheel_pending = false;
 
-	return _send_nvim_input_mouse(button_name, "drag", modifiers, current_grid_id, row, column);
-}
+	// Whole steps are sent; the remainder carries over to the next frame.
+	int32_t steps_x = static_cast<int32_t>(wheel_delta_x);
+	int32_t steps_y = static_cast<int32_t>(wheel_delta_y);
+	wheel_delta_x -= steps_x;
+	wheel_delta_y -= steps_y;
+	steps_x = std::clamp(steps_x, -WHEEL_STEPS_PER_FRAME_MAX, WHEEL_STEPS_PER_FRAME_MAX);
+	steps_y = std::clamp(steps_y, -WHEEL_STEPS_PER_FRAME_MAX, WHEEL_STEPS_PER_FRAME_MAX);
+	if (steps_x == 0 && steps_y == 0) {
+		return;
+	}
 
-String NvimPanel::_translate_key_event(const Ref<InputEventKey> &p_key_event) const {
-	Key keycode = static_cast<Key>(p_key_event->get_keycode());
-	bool shift = p_key_event->is_shift_pressed();
-	bool ctrl = p_key_event->is_ctrl_pressed();
-	bool alt = p_key_event->is_alt_pressed();
-	char32_t unicode = p_key_event->get_unicode();
-
-	switch (keycode) {
-		case Key::KEY_ENTER:
-		case Key::KEY_KP_ENTER:
-			return _format_special_key("CR", shift, ctrl, alt);
-		case Key::KEY_TAB:
-			return _format_special_key("Tab", shift, ctrl, alt);
-		case Key::KEY_BACKTAB:
-			return _format_special_key("Tab", true, ctrl, alt);
-		case Key::KEY_ESCAPE:
-			return _format_special_key("Esc", shift, ctrl, alt);
-		case Key::KEY_BACKSPACE:
-			return _format_special_key("BS", shift, ctrl, alt);
-		case Key::KEY_SPACE:
-			if (ctrl || alt || shift) {
-				return _format_special_key("Space", shift, ctrl, alt);
+	// Keys typed before the scroll must reach Neovim first.
+	_flush_pending_keys();
+
+	struct WheelAxis {
+		int32_t steps;
+		const char *negative;
+		const char *positive;
+	};
+	const WheelAxis axes[] = { { steps_y, "Up", "Down" }, { steps_x, "Left", "Right" } };
+
+	if (multigrid_attached) {
+		// Wheel keys go to the window under the last mouse position, which Neovim only
+		// knows per grid with ext_multigrid; send the wheel with its grid instead.
+		int64_t row = 0;
+		int64_t column = 0;
+		int64_t grid_id = current_grid_id;
+		_convert_position_to_cell(wheel_position, row, column);
+		_find_grid_at(row, column, grid_id, row, column);
+		for (const WheelAxis &axis : axes) {
+			String direction = String(axis.steps < 0 ? axis.negative : axis.positive).to_lower();
+			for (int32_t i = 0; i < std::abs(axis.steps); ++i) {
+				if (rpc_writer.notify("nvim_input_mouse", "wheel", direction, wheel_modifiers, grid_id, row, column)) {
+					++mouse_events_sent;
+					++mouse_messages_sent;
+				}
 			}
-			return String(" ");
-		case Key::KEY_UP:
-			return _format_special_key("Up", shift, ctrl, alt);
-		case Key::KEY_DOWN:
-			return _format_special_key("Down", shift, ctrl, alt);
-		case Key::KEY_LEFT:
-			return _format_special_key("Left", shift, ctrl, alt);
-		case Key::KEY_RIGHT:
-			return _format_special_key("Right", shift, ctrl, alt);
-		case Key::KEY_HOME:
-			return _format_special_key("Home", shift, ctrl, alt);
-		case Key::KEY_END:
-			return _format_special_key("End", shift, ctrl, alt);
-		case Key::KEY_PAGEUP:
-			return _format_special_key("PageUp", shift, ctrl, alt);
-		case Key::KEY_PAGEDOWN:
-			return _format_special_key("PageDown", shift, ctrl, alt);
-		case Key::KEY_INSERT:
-			return _format_special_key("Insert", shift, ctrl, alt);
-		case Key::KEY_DELETE:
-			return _format_special_key("Del", shift, ctrl, alt);
-		default:
-			break;
+		}
+		return;
 	}
 
-	if (keycode >= Key::KEY_F1 && keycode <= Key::KEY_F24) {
-		int fn = static_cast<int>(keycode) - static_cast<int>(Key::KEY_F1) + 1;
-		return _format_special_key(String("F") + String::num_int64(fn), shift, ctrl, alt);
+	// Without multigrid every step of the frame goes out in a single nvim_input.
+	std::string keys;
+	uint8_t modifiers = NvimKeyNotation::modifiers(wheel_shift, wheel_ctrl, wheel_alt);
+	for (const WheelAxis &axis : axes) {
+		std::string name = std::string("ScrollWheel") + (axis.steps < 0 ? axis.negative : axis.positive);
+		for (int32_t i = 0; i < std::abs(axis.steps); ++i) {
+			NvimKeyNotation::append_named(keys, name.c_str(), modifiers);
+		}
 	}
+	if (rpc_writer.notify("nvim_input", keys)) {
+		mouse_events_sent += std::abs(steps_x) + std::abs(steps_y);
+		++mouse_messages_sent;
+	}
+}
 
-	char32_t base_char = unicode;
-	if (base_char == 0) {
-		if (keycode >= Key::KEY_A && keycode <= Key::KEY_Z) {
-			int offset = static_cast<int>(keycode) - static_cast<int>(Key::KEY_A);
-			base_char = shift ? static_cast<char32_t>('A' + offset) : static_cast<char32_t>('a' + offset);
-		} else if (keycode >= Key::KEY_0 && keycode <= Key::KEY_9) {
-			int offset = static_cast<int>(keycode) - static_cast<int>(Key::KEY_0);
-			base_char = static_cast<char32_t>('0' + offset);
-		}
+void NvimPanel::_reset_mouse_coalescing() {
+	wheel_pending = false;
+	wheel_delta_x = 0.0;
+	wheel_delta_y = 0.0;
+	drag_button = String();
+}
+
+bool NvimPanel::_start_paste(const String &p_text) {
+	if (!nvim_client || !nvim_client->is_running() || p_text.is_empty()) {
+		return false;
 	}
+	if (paste_active) {
+		UtilityFunctions::printerr("[nvim_embed] A paste is still being sent; ignoring the new one.");
+		return true;
+	}
+
+	CharString text_utf8 = p_text.utf8();
+	paste_data.assign(text_utf8.get_data(), static_cast<size_t>(text_utf8.length()));
+	paste_offset = 0;
+	paste_started = false;
+	paste_active = true;
+	++paste_generation;
+	++pastes_started;
+	// Keys typed before the paste go first; the first chunks leave with this frame.
+	_flush_pending_keys();
+	_pump_paste();
+	return true;
+}
+
+void NvimPanel::_pump_paste() {
+	while (paste_active && paste_chunks_in_flight < PASTE_CHUNKS_IN_FLIGHT) {
+		size_t remaining = paste_data.size() - paste_offset;
+		size_t length = std::min(remaining, PASTE_CHUNK_BYTES);
+		// Chunks end on a character boundary.
+		while (length < remaining && length > 0 && (static_cast<uint8_t>(paste_data[paste_offset + length]) & 0xC0) == 0x80) {
+			--length;
+		}
+		if (length == 0) {
+			length = std::min(remaining, PASTE_CHUNK_BYTES);
+		}
 
-	if (base_char >= 32 && base_char != 127) {
-		String text = String::chr(base_char);
-		if (ctrl || alt) {
-			String key_name = text;
-			if (key_name.length() == 1 && key_name[0] >= 'a' && key_name[0] <= 'z') {
-				key_name = key_name.to_upper();
+		// Phase -1 is a paste in one call; otherwise 1 starts, 2 continues and 3 ends it.
+		bool last = length == remaining;
+		int32_t phase = !paste_started ? (last ? -1 : 1) : (last ? 3 : 2);
+		std::string_view chunk(paste_data.data() + paste_offset, length);
+		uint32_t request_id = rpc_writer.call("nvim_paste", chunk, true, phase);
+		if (request_id == 0) {
+			_cancel_paste(true);
+			return;
+		}
+
+		++paste_chunks_in_flight;
+		paste_started = true;
+		paste_offset += length;
+		paste_bytes_sent += static_cast<int64_t>(length);
+		// Answers to chunks of a paste that was since cancelled must not touch the next one.
+		uint32_t generation = paste_generation;
+		_track_request(request_id, [this, generation](const NvimRpcResponse &p_response) {
+			if (generation != paste_generation) {
+				return;
+			}
+			paste_chunks_in_flight = std::max(paste_chunks_in_flight - 1, 0);
+			// nvim_paste returns false when the user cancelled (e.g. with <Esc>); stop sending.
+			bool cancelled = p_response.status == NvimRpcResponse::STATUS_ERROR || (p_response.status == NvimRpcResponse::STATUS_OK && mpack_node_type(*p_response.value) == mpack_type_bool && !mpack_node_bool(*p_response.value));
+			if (cancelled && paste_active) {
+				if (p_response.status == NvimRpcResponse::STATUS_ERROR) {
+					UtilityFunctions::printerr("[nvim_embed] nvim_paste failed: ", _format_rpc_error(*p_response.value));
+				}
+				_cancel_paste(true);
 			}
-			return _format_special_key(key_name, shift, ctrl, alt);
+		});
+
+		if (last) {
+			paste_active = false;
+			paste_data = std::string();
+			paste_offset = 0;
 		}
-		return text;
 	}
-
-	return String();
 }
 
-String NvimPanel::_format_special_key(const String &p_key_name, bool p_shift, bool p_ctrl, bool p_alt) const {
-	PackedStringArray modifiers;
-	if (p_ctrl) {
-		modifiers.push_back("C");
+void NvimPanel::_cancel_paste(bool p_end_stream) {
+	// A stream opened with phase 1 stays open in Neovim until phase 3 arrives.
+	if (p_end_stream && paste_active && paste_started && is_running()) {
+		uint32_t request_id = rpc_writer.call("nvim_paste", "", false, 3);
+		if (request_id != 0) {
+			_track_request(request_id, nullptr);
+		}
 	}
-	if (p_shift) {
-		modifiers.push_back("S");
+	++paste_generation;
+	paste_active = false;
+	paste_started = false;
+	paste_data = std::string();
+	paste_offset = 0;
+	paste_chunks_in_flight = 0;
+}
+
+bool NvimPanel::_handle_mouse_motion_event(const Ref<InputEventMouseMotion> &p_motion_event) {
+	if (p_motion_event.is_null()) {
+		return false;
 	}
-	if (p_alt) {
-		modifiers.push_back("A");
+
+	int32_t mask = p_motion_event->get_button_mask();
+	String button_name;
+	if (mask & static_cast<int32_t>(MouseButtonMask::MOUSE_BUTTON_MASK_LEFT)) {
+		button_name = "left";
+	} else if (mask & static_cast<int32_t>(MouseButtonMask::MOUSE_BUTTON_MASK_RIGHT)) {
+		button_name = "right";
+	} else if (mask & static_cast<int32_t>(MouseButtonMask::MOUSE_BUTTON_MASK_MIDDLE)) {
+		button_name = "middle";
+	} else {
+		return false;
 	}
 
-	String inside;
-	for (int i = 0; i < modifiers.size(); ++i) {
-		inside += modifiers[i];
-		inside += "-";
+	++mouse_events_received;
+	int64_t row = 0;
+	int64_t column = 0;
+	_convert_position_to_cell(p_motion_event->get_position(), row, column);
+	int64_t grid_id = current_grid_id;
+	_find_grid_at(row, column, grid_id, row, column);
+	// Motion within a cell is dropped; only a drag into another cell is sent.
+	if (button_name == drag_button && grid_id == drag_grid_id && row == drag_row && column == drag_column) {
+		return true;
 	}
-	inside += p_key_name;
-	return "<" + inside + ">";
+	drag_button = button_name;
+	drag_grid_id = grid_id;
+	drag_row = row;
+	drag_column = column;
+
+	String modifiers = _build_modifier_string(p_motion_event->is_shift_pressed(), p_motion_event->is_ctrl_pressed(), p_motion_event->is_alt_pressed());
+	return _send_nvim_input_mouse(button_name, "drag", modifiers, grid_id, row, column);
 }
 
 String NvimPanel::_build_modifier_string(bool p_shift, bool p_ctrl, bool p_alt) const {
@@ -1311,66 +2765,248 @@ void NvimPanel::_convert_position_to_cell(const Vector2 &p_position, int64_t &r_
 	r_row = row;
 }
 
-void NvimPanel::_sync_neovim_size_to_canvas() {
-	if (!grid_canvas || !nvim_client || !nvim_client->is_running()) {
-		return;
+bool NvimPanel::_find_grid_at(int64_t p_row, int64_t p_column, int64_t &r_grid_id, int64_t &r_row, int64_t &r_column) const {
+	if (!multigrid_attached) {
+		return false;
+	}
+
+	// Topmost visible window grid wins; otherwise the cell belongs to the default grid.
+	int64_t best_grid = MULTIGRID_DEFAULT_GRID_ID;
+	int32_t best_index = -1;
+	const NvimGridPlacement *best_placement = nullptr;
+	for (const auto &entry : grid_placements) {
+		const NvimGridPlacement &placement = entry.second;
+		auto grid_it = grids.find(entry.first);
+		if (!placement.visible || grid_it == grids.end()) {
+			continue;
+		}
+		const NvimGrid &grid = grid_it->second;
+		if (p_row < placement.row || p_row >= placement.row + grid.rows || p_column < placement.column || p_column >= placement.column + grid.columns) {
+			continue;
+		}
+		int32_t draw_index = placement.floating ? 2 + placement.zindex : 1;
+		if (draw_index > best_index) {
+			best_index = draw_index;
+			best_grid = entry.first;
+			best_placement = &placement;
+		}
+	}
+
+	r_grid_id = best_grid;
+	if (best_placement) {
+		r_row = p_row - best_placement->row;
+		r_column = p_column - best_placement->column;
+	} else {
+		r_row = p_row;
+		r_column = p_column;
+	}
+	return true;
+}
+
+bool NvimPanel::_compute_canvas_grid_size(int32_t &r_columns, int32_t &r_rows) {
+	if (!grid_canvas) {
+		return false;
 	}
 
 	_ensure_cell_metrics();
 	if (cell_width <= 0.0f || cell_height <= 0.0f) {
-		return;
+		return false;
 	}
 
 	Vector2 canvas_size = grid_canvas->get_size();
 	if (canvas_size.x <= 0.0f || canvas_size.y <= 0.0f) {
+		return false;
+	}
+
+	r_columns = Math::max(1, static_cast<int32_t>(canvas_size.x / cell_width));
+	r_rows = Math::max(1, static_cast<int32_t>(canvas_size.y / cell_height));
+	return true;
+}
+
+void NvimPanel::_sync_neovim_size_to_canvas() {
+	if (!ui_attached || !nvim_client || !nvim_client->is_running()) {
 		return;
 	}
 
-	int32_t new_columns = Math::max(1, static_cast<int32_t>(canvas_size.x / cell_width));
-	int32_t new_rows = Math::max(1, static_cast<int32_t>(canvas_size.y / cell_height));
+	int32_t new_columns = 0;
+	int32_t new_rows = 0;
+	if (!_compute_canvas_grid_size(new_columns, new_rows)) {
+		return;
+	}
 
 	if (new_columns != grid_columns || new_rows != grid_rows) {
 		if (_send_ui_try_resize(new_columns, new_rows)) {
+			Time *time = Time::get_singleton();
+			last_resize_sent_usec = time ? time->get_ticks_usec() : 0;
+			++resize_requests_sent;
 			grid_columns = new_columns;
 			grid_rows = new_rows;
-			_ensure_grid(current_grid_id, grid_columns, grid_rows);
+			_ensure_grid(_get_main_grid_id(), grid_columns, grid_rows);
 			_update_canvas_size();
 		}
 	}
 }
 
+void NvimPanel::_flush_pending_resize() {
+	// Until the first attach the size is still being measured; the pending flag is
+	// kept so the settled size gets checked once the UI is attached.
+	if (!resize_pending || !ui_attached) {
+		return;
+	}
+
+	Time *time = Time::get_singleton();
+	uint64_t now_usec = time ? time->get_ticks_usec() : 0;
+	if (now_usec - last_resize_sent_usec < resize_interval_usec) {
+		return;
+	}
+
+	resize_pending = false;
+	_sync_neovim_size_to_canvas();
+}
+
+void NvimPanel::_flush_outbound() {
+	// Output that arrived before the keys go out cannot be their echo; apply it first so
+	// the echo latency is matched against what Neovim sends after reading them.
+	if (input_echo_unsent || !pending_keys.empty()) {
+		_poll_nvim();
+	}
+
+	// Everything queued this frame (keys, mouse, resize, attach) leaves in one writev.
+	if (!nvim_client || !nvim_client->is_running()) {
+		pending_keys.clear();
+		rpc_writer.clear();
+		return;
+	}
+	_flush_pending_keys();
+	_flush_pending_wheel();
+	if (!rpc_writer.has_pending()) {
+		return;
+	}
+	if (input_echo_unsent || echo_wait_armed) {
+		// A batch Neovim is still in the middle of ends with a flush that predates the keys.
+		// With the decode thread, that batch may not have reached the main thread at all.
+		bool batch_underway = redraw_batch_open || (rpc_reader.is_active() && rpc_reader.has_unfinished_batch());
+		if (input_echo_unsent) {
+			input_echo_skip_batch = batch_underway;
+			input_echo_unsent = false;
+		}
+		if (echo_wait_armed) {
+			echo_wait_skip_batch = batch_underway;
+			echo_wait_answered = false;
+		}
+	}
+	rpc_writer.flush(nvim_client.get());
+}
+
 bool NvimPanel::_send_ui_try_resize(int32_t p_columns, int32_t p_rows) {
 	if (!nvim_client || !nvim_client->is_running()) {
 		return false;
 	}
 
-	char *buffer = nullptr;
-	size_t buffer_size = 0;
-	mpack_writer_t writer;
-	mpack_writer_init_growable(&writer, &buffer, &buffer_size);
+	return rpc_writer.notify("nvim_ui_try_resize", p_columns, p_rows);
+}
 
-	uint32_t request_id = next_request_id++;
-	mpack_start_array(&writer, 4);
-	mpack_write_i32(&writer, 0);
-	mpack_write_u32(&writer, request_id);
-	mpack_write_cstr(&writer, "nvim_ui_try_resize");
-	mpack_start_array(&writer, 2);
-	mpack_write_i32(&writer, p_columns);
-	mpack_write_i32(&writer, p_rows);
-	mpack_finish_array(&writer);
-	mpack_finish_array(&writer);
+bool NvimPanel::_send_ui_detach() {
+	if (!nvim_client || !nvim_client->is_running()) {
+		return false;
+	}
 
-	mpack_error_t writer_error = mpack_writer_destroy(&writer);
-	if (writer_error != mpack_ok || !buffer || buffer_size == 0) {
-		if (buffer) {
-			std::free(buffer);
-		}
+	ui_attached = false;
+	return rpc_writer.notify("nvim_ui_detach");
+}
+
+bool NvimPanel::_send_ui_set_focus(bool p_focused) {
+	if (!nvim_client || !nvim_client->is_running()) {
 		return false;
 	}
 
-	size_t written = nvim_client->write(reinterpret_cast<const uint8_t *>(buffer), buffer_size);
-	std::free(buffer);
-	return written == buffer_size;
+	return rpc_writer.notify("nvim_ui_set_focus", p_focused);
+}
+
+void NvimPanel::_set_background(bool p_background) {
+	if (in_background == p_background) {
+		return;
+	}
+	in_background = p_background;
+
+	if (!is_running()) {
+		return;
+	}
+	if (p_background) {
+		if (ui_attached) {
+			_send_ui_set_focus(false);
+			_send_ui_detach();
+		}
+		redraw_pending = false;
+		if (debug_logging_enabled) {
+			UtilityFunctions::print("[nvim_embed] Panel hidden; detached the UI.");
+		}
+	} else if (!ui_attached && !attach_pending) {
+		_reattach_ui();
+	}
+}
+
+void NvimPanel::_attach_when_laid_out() {
+	if (!is_running()) {
+		attach_pending = false;
+		return;
+	}
+
+	int32_t columns = grid_columns;
+	int32_t rows = grid_rows;
+	bool measured = _compute_canvas_grid_size(columns, rows);
+	if (!in_background) {
+		bool settled = measured && columns == attach_probe_columns && rows == attach_probe_rows;
+		attach_probe_columns = columns;
+		attach_probe_rows = rows;
+		Time *time = Time::get_singleton();
+		uint64_t now_usec = time ? time->get_ticks_usec() : 0;
+		if (!settled && now_usec - nvim_start_usec < ATTACH_LAYOUT_TIMEOUT_USEC) {
+			return;
+		}
+	}
+
+	attach_pending = false;
+	grid_columns = columns;
+	grid_rows = rows;
+	_ensure_grid(current_grid_id, grid_columns, grid_rows);
+	_update_canvas_size();
+	_send_ui_attach();
+
+	// A hidden panel still attaches once so Neovim can finish starting, then lets go;
+	// showing the tab reattaches at the real size.
+	if (in_background && ui_attached) {
+		_send_ui_set_focus(false);
+		_send_ui_detach();
+	}
+}
+
+void NvimPanel::_reattach_ui() {
+	// Apply whatever was buffered under the old attachment first, then start from empty
+	// grids: the new attachment begins with a full frame at the current canvas size.
+	_poll_nvim();
+	if (!is_running()) {
+		return;
+	}
+
+	grids.clear();
+	grid_placements.clear();
+	grid_toplines.clear();
+	int32_t columns = grid_columns;
+	int32_t rows = grid_rows;
+	if (_compute_canvas_grid_size(columns, rows)) {
+		grid_columns = columns;
+		grid_rows = rows;
+	}
+	_ensure_grid(current_grid_id, grid_columns, grid_rows);
+	_update_canvas_size();
+
+	_send_ui_attach();
+	_send_ui_set_focus(true);
+	_request_grid_redraw();
+	if (debug_logging_enabled) {
+		UtilityFunctions::print("[nvim_embed] Panel shown; reattached the UI at ", grid_columns, "x", grid_rows, ".");
+	}
 }
 
 void NvimPanel::_on_status_button_pressed() {
@@ -1388,17 +3024,17 @@ String NvimPanel::_quote_path_for_command(const String &p_path) const {
 }
 
 void NvimPanel::_reset_highlight_defaults() {
-	Highlight base;
+	NvimHighlight base;
 	base.foreground = theme_default_foreground;
 	base.background = theme_default_background;
 	base.has_foreground = true;
 	base.has_background = true;
-	highlight_definitions[0] = base;
+	palette.highlights[0] = base;
 }
 
 void NvimPanel::_apply_theme_defaults(bool p_update_immediately) {
-	default_foreground = theme_default_foreground;
-	default_background = theme_default_background;
+	palette.default_foreground = theme_default_foreground;
+	palette.default_background = theme_default_background;
 	if (p_update_immediately) {
 		_reset_highlight_defaults();
 		_request_grid_redraw();
@@ -1571,35 +3207,27 @@ void NvimPanel::_apply_theme_to_running_instance() {
 }
 
 void NvimPanel::_on_canvas_resized() {
-	_sync_neovim_size_to_canvas();
-}
-
-void NvimPanel::_ensure_cell_metrics() {
-	if (cell_width > 0.0f && cell_height > 0.0f) {
-		return;
+	if (resize_pending) {
+		++resize_events_coalesced;
 	}
+	resize_pending = true;
+}
 
-	Ref<Font> font = _obtain_font();
-	if (font.is_null()) {
+void NvimPanel::_refresh_fonts() {
+	// configure() re-resolves the size and is a no-op when neither the chain nor the size moved.
+	if (!font_cache.configure(font_path_setting.is_empty() ? _get_default_font_path() : font_path_setting, fallback_fonts_setting, font_size)) {
 		return;
 	}
+	resize_pending = true;
+	_mark_all_grids_dirty();
+	_request_grid_redraw();
+}
 
-	int32_t size = _obtain_font_size();
-	Vector2 char_size = font->get_char_size(U'M', size);
-	float cw = char_size.x;
-	if (cw <= 0.0f) {
-		char_size = font->get_char_size(U' ', size);
-		cw = char_size.x;
-	}
-	if (cw <= 0.0f) {
-		cw = font->get_height(size) * 0.6f;
-	}
-	float ch = font->get_height(size);
-	float ascent = font->get_ascent(size);
-
-	cell_width = cw > 0.0f ? cw : 1.0f;
-	cell_height = ch > 0.0f ? ch : 1.0f;
-	cell_ascent = ascent >= 0.0f ? ascent : cell_height * 0.8f;
+void NvimPanel::_ensure_cell_metrics() {
+	const NvimFontCache::Metrics &metrics = font_cache.get_metrics();
+	cell_width = metrics.cell_width;
+	cell_height = metrics.cell_height;
+	cell_ascent = metrics.ascent;
 }
 
 void NvimPanel::reload_settings() {
@@ -1608,8 +3236,19 @@ void NvimPanel::reload_settings() {
 	const bool default_autostart = true;
 	const String default_font_path = _get_default_font_path();
 	const PackedStringArray default_args;
+	const PackedStringArray default_fallback_fonts;
 	const String default_theme = "default";
 	const bool default_debug_logging = false;
+	const String default_renderer = "canvas";
+	const int32_t default_row_texture_cache_mb = 0;
+	const int32_t default_row_prepare_tasks = 0;
+	const int32_t default_max_fps = 0;
+	const int32_t default_resize_interval_ms = 50;
+	const int32_t default_smooth_scroll_ms = 0;
+	const bool default_decode_thread = false;
+	const bool default_clipboard_provider = true;
+	const bool default_predictive_echo = false;
+	const int32_t default_echo_wait_ms = 0;
 
 	ProjectSettings *ps = ProjectSettings::get_singleton();
 
@@ -1617,9 +3256,20 @@ void NvimPanel::reload_settings() {
 	bool autostart_value = default_autostart;
 	String font_path_value = default_font_path;
 	int32_t font_size_value = default_font_size;
+	PackedStringArray fallback_fonts_value = default_fallback_fonts;
 	PackedStringArray extra_args_value = default_args;
 	String theme_value = default_theme;
 	bool debug_logging_value = default_debug_logging;
+	String renderer_value = default_renderer;
+	int32_t row_texture_cache_mb_value = default_row_texture_cache_mb;
+	int32_t row_prepare_tasks_value = default_row_prepare_tasks;
+	int32_t max_fps_value = default_max_fps;
+	int32_t resize_interval_ms_value = default_resize_interval_ms;
+	int32_t smooth_scroll_ms_value = default_smooth_scroll_ms;
+	bool decode_thread_value = default_decode_thread;
+	bool clipboard_provider_value = default_clipboard_provider;
+	bool predictive_echo_value = default_predictive_echo;
+	int32_t echo_wait_ms_value = default_echo_wait_ms;
 
 	if (ps) {
 		if (ps->has_setting("neovim/embed/command")) {
@@ -1646,6 +3296,12 @@ void NvimPanel::reload_settings() {
 				font_size_value = static_cast<int32_t>((int64_t)v);
 			}
 		}
+		if (ps->has_setting("neovim/embed/fallback_fonts")) {
+			Variant v = ps->get_setting("neovim/embed/fallback_fonts");
+			if (v.get_type() == Variant::PACKED_STRING_ARRAY) {
+				fallback_fonts_value = (PackedStringArray)v;
+			}
+		}
 		if (ps->has_setting("neovim/embed/extra_args")) {
 			Variant v = ps->get_setting("neovim/embed/extra_args");
 			if (v.get_type() == Variant::PACKED_STRING_ARRAY) {
@@ -1664,16 +3320,106 @@ void NvimPanel::reload_settings() {
 				debug_logging_value = (bool)v;
 			}
 		}
+		if (ps->has_setting("neovim/embed/renderer")) {
+			Variant v = ps->get_setting("neovim/embed/renderer");
+			if (v.get_type() == Variant::STRING) {
+				renderer_value = ((String)v).strip_edges().to_lower();
+			}
+		}
+		if (ps->has_setting("neovim/embed/row_texture_cache_mb")) {
+			Variant v = ps->get_setting("neovim/embed/row_texture_cache_mb");
+			if (v.get_type() == Variant::INT) {
+				row_texture_cache_mb_value = static_cast<int32_t>((int64_t)v);
+			}
+		}
+		if (ps->has_setting("neovim/embed/row_prepare_tasks")) {
+			Variant v = ps->get_setting("neovim/embed/row_prepare_tasks");
+			if (v.get_type() == Variant::INT) {
+				row_prepare_tasks_value = static_cast<int32_t>((int64_t)v);
+			}
+		}
+		if (ps->has_setting("neovim/embed/max_fps")) {
+			Variant v = ps->get_setting("neovim/embed/max_fps");
+			if (v.get_type() == Variant::INT) {
+				max_fps_value = static_cast<int32_t>((int64_t)v);
+			}
+		}
+		if (ps->has_setting("neovim/embed/resize_interval_ms")) {
+			Variant v = ps->get_setting("neovim/embed/resize_interval_ms");
+			if (v.get_type() == Variant::INT) {
+				resize_interval_ms_value = static_cast<int32_t>((int64_t)v);
+			}
+		}
+		if (ps->has_setting("neovim/embed/smooth_scroll_ms")) {
+			Variant v = ps->get_setting("neovim/embed/smooth_scroll_ms");
+			if (v.get_type() == Variant::INT) {
+				smooth_scroll_ms_value = static_cast<int32_t>((int64_t)v);
+			}
+		}
+		if (ps->has_setting("neovim/embed/decode_thread")) {
+			Variant v = ps->get_setting("neovim/embed/decode_thread");
+			if (v.get_type() == Variant::BOOL) {
+				decode_thread_value = (bool)v;
+			}
+		}
+		if (ps->has_setting("neovim/embed/clipboard_provider")) {
+			Variant v = ps->get_setting("neovim/embed/clipboard_provider");
+			if (v.get_type() == Variant::BOOL) {
+				clipboard_provider_value = (bool)v;
+			}
+		}
+		if (ps->has_setting("neovim/embed/predictive_echo")) {
+			Variant v = ps->get_setting("neovim/embed/predictive_echo");
+			if (v.get_type() == Variant::BOOL) {
+				predictive_echo_value = (bool)v;
+			}
+		}
+		if (ps->has_setting("neovim/embed/echo_wait_ms")) {
+			Variant v = ps->get_setting("neovim/embed/echo_wait_ms");
+			if (v.get_type() == Variant::INT) {
+				echo_wait_ms_value = static_cast<int32_t>((int64_t)v);
+			}
+		}
 	}
 
 	nvim_command = command_value.is_empty() ? default_command : command_value;
 	autostart = autostart_value;
 	font_path_setting = font_path_value;
 	font_size = font_size_value > 0 ? font_size_value : default_font_size;
+	fallback_fonts_setting = fallback_fonts_value;
+	// Loaded fonts stay cached, so a reload only touches disk for paths not seen before.
+	font_cache.configure(font_path_setting.is_empty() ? default_font_path : font_path_setting, fallback_fonts_setting, font_size);
 	extra_args_setting = extra_args_value;
 	_load_theme_definition(theme_value);
 	debug_logging_enabled = debug_logging_value;
-	cached_font.unref();
+	if (renderer_value != "canvas" && renderer_value != "gpu") {
+		UtilityFunctions::printerr("[nvim_embed] Unknown renderer '", renderer_value, "'; using 'canvas'.");
+		renderer_value = default_renderer;
+	}
+	renderer_setting = renderer_value;
+	row_texture_cache_limit = static_cast<int64_t>(std::max(row_texture_cache_mb_value, 0)) * 1024 * 1024;
+	row_prepare_tasks = std::max(row_prepare_tasks_value, 0);
+	frame_interval_usec = _compute_frame_interval_usec(max_fps_value);
+	resize_interval_usec = static_cast<uint64_t>(std::max(resize_interval_ms_value, 0)) * 1000;
+	// Font changes alter the cell size, so the grid size is rechecked too.
+	resize_pending = true;
+	smooth_scroll_time = std::max(smooth_scroll_ms_value, 0) / 1000.0;
+	// ext_multigrid is chosen at attach time, so a renderer or smooth scroll change that
+	// flips it takes effect by attaching again.
+	bool wants_multigrid = smooth_scroll_time > 0.0 && renderer_setting == "canvas";
+	if (ui_attached && !in_background && wants_multigrid != multigrid_attached) {
+		_send_ui_detach();
+		_reattach_ui();
+	}
+	decode_thread_setting = decode_thread_value;
+	clipboard_provider_setting = clipboard_provider_value;
+	predictive_echo_setting = predictive_echo_value;
+	if (!predictive_echo_setting) {
+		predictive_echo.release();
+	}
+	// The wait blocks the editor's main thread, so it is capped well below a frame.
+	echo_wait_usec = static_cast<uint64_t>(std::clamp(echo_wait_ms_value, 0, ECHO_WAIT_MAX_MS)) * 1000;
+	_mark_all_grids_dirty();
 	const bool running = is_running();
 	_apply_theme_defaults(!running);
 	if (running) {
@@ -1691,112 +3437,138 @@ bool NvimPanel::_send_nvim_input(const String &p_keys) {
 		return false;
 	}
 
-	CharString method_utf8 = String("nvim_input").utf8();
 	CharString keys_utf8 = p_keys.utf8();
+	_begin_key_input();
+	pending_keys.append(keys_utf8.get_data(), static_cast<size_t>(keys_utf8.length()));
+	++key_inputs_queued;
+	return true;
+}
 
-	char *buffer = nullptr;
-	size_t buffer_size = 0;
-	mpack_writer_t writer;
-	mpack_writer_init_growable(&writer, &buffer, &buffer_size);
-
-	uint32_t request_id = next_request_id++;
-	mpack_start_array(&writer, 4);
-	mpack_write_i32(&writer, 0);
-	mpack_write_u32(&writer, request_id);
-	mpack_write_cstr(&writer, method_utf8.get_data());
-	mpack_start_array(&writer, 1);
-	mpack_write_cstr(&writer, keys_utf8.get_data());
-	mpack_finish_array(&writer);
-	mpack_finish_array(&writer);
-
-	mpack_error_t writer_error = mpack_writer_destroy(&writer);
-	if (writer_error != mpack_ok || !buffer || buffer_size == 0) {
-		if (buffer) {
-			std::free(buffer);
-		}
+bool NvimPanel::_queue_key_event(Key p_keycode, char32_t p_unicode, uint8_t p_modifiers) {
+	if (!nvim_client || !nvim_client->is_running()) {
 		return false;
 	}
 
-	size_t written = nvim_client->write(reinterpret_cast<const uint8_t *>(buffer), buffer_size);
-	std::free(buffer);
-	return written == buffer_size;
+	// The notation is appended straight to the frame's input buffer.
+	_begin_key_input();
+	if (!NvimKeyNotation::append_key(pending_keys, p_keycode, p_unicode, p_modifiers)) {
+		return false;
+	}
+	++key_inputs_queued;
+	return true;
 }
 
-bool NvimPanel::_send_nvim_command(const String &p_command) {
-	if (!nvim_client || !nvim_client->is_running()) {
-		return false;
+void NvimPanel::_begin_key_input() {
+	// Keys are collected for the frame and sent as one nvim_input from _flush_outbound().
+	// A scroll earlier in the frame goes out first to keep the order.
+	_flush_pending_wheel();
+	if (pending_keys.empty()) {
+		Time *time = Time::get_singleton();
+		pending_keys_usec = time ? time->get_ticks_usec() : 0;
+		pending_keys_frame = Engine::get_singleton()->get_process_frames();
 	}
+}
 
-	CharString method_utf8 = String("nvim_command").utf8();
-	CharString command_utf8 = p_command.utf8();
+bool NvimPanel::_flush_pending_keys() {
+	if (pending_keys.empty()) {
+		return true;
+	}
 
-	char *buffer = nullptr;
-	size_t buffer_size = 0;
-	mpack_writer_t writer;
-	mpack_writer_init_growable(&writer, &buffer, &buffer_size);
+	bool queued = rpc_writer.notify("nvim_input", pending_keys);
+	pending_keys.clear();
+	if (queued) {
+		++key_input_calls_sent;
+		echo_wait_armed = true;
+		if (input_echo_start_usec == 0) {
+			input_echo_start_usec = pending_keys_usec;
+			input_echo_start_frame = pending_keys_frame;
+			input_echo_unsent = true;
+		}
+	}
+	return queued;
+}
 
-	uint32_t request_id = next_request_id++;
-	mpack_start_array(&writer, 4);
-	mpack_write_i32(&writer, 0);
-	mpack_write_u32(&writer, request_id);
-	mpack_write_cstr(&writer, method_utf8.get_data());
-	mpack_start_array(&writer, 1);
-	mpack_write_cstr(&writer, command_utf8.get_data());
-	mpack_finish_array(&writer);
-	mpack_finish_array(&writer);
+void NvimPanel::_wait_for_echo() {
+	if (!echo_wait_armed) {
+		return;
+	}
+	echo_wait_armed = false;
+	Time *time = Time::get_singleton();
+	if (echo_wait_usec == 0 || !time || !nvim_client || !nvim_client->is_running()) {
+		return;
+	}
 
-	mpack_error_t writer_error = mpack_writer_destroy(&writer);
-	if (writer_error != mpack_ok || !buffer || buffer_size == 0) {
-		if (buffer) {
-			std::free(buffer);
+	// Keys just left with this frame. Neovim usually answers within a millisecond or two, so
+	// a short bounded wait lets the echo be applied before the frame is drawn instead of in
+	// the next one. Only the flush answering these keys ends the wait early; one finishing a
+	// batch Neovim had started before reading them does not.
+	uint64_t start_usec = time->get_ticks_usec();
+	uint64_t deadline_usec = start_usec + echo_wait_usec;
+	for (uint64_t now_usec = start_usec; !echo_wait_answered && now_usec < deadline_usec && nvim_client->is_running(); now_usec = time->get_ticks_usec()) {
+		bool readable = rpc_reader.is_active() ? rpc_reader.wait_for_messages(deadline_usec - now_usec) : nvim_client->wait_readable(deadline_usec - now_usec);
+		if (!readable) {
+			break;
 		}
-		return false;
+		_poll_nvim();
 	}
 
-	size_t written = nvim_client->write(reinterpret_cast<const uint8_t *>(buffer), buffer_size);
-	std::free(buffer);
-	return written == buffer_size;
+	++echo_waits;
+	echo_wait_total_usec += static_cast<int64_t>(time->get_ticks_usec() - start_usec);
+	if (echo_wait_answered) {
+		++echo_wait_hits;
+		// The wait was spent to show the echo in this frame; max_fps pacing must not hold it
+		// back. The pacing deadline restarts from this present.
+		next_frame_present_usec = 0;
+	}
 }
 
-bool NvimPanel::_send_nvim_input_mouse(const String &p_button, const String &p_action, const String &p_modifiers, int64_t p_grid, int64_t p_row, int64_t p_column) {
+bool NvimPanel::_send_nvim_command(const String &p_command) {
 	if (!nvim_client || !nvim_client->is_running()) {
 		return false;
 	}
 
-	CharString method_utf8 = String("nvim_input_mouse").utf8();
-	CharString button_utf8 = p_button.utf8();
-	CharString action_utf8 = p_action.utf8();
-	CharString mod_utf8 = p_modifiers.utf8();
+	Array args;
+	args.push_back(p_command);
+	// Errors such as E492 used to vanish with the discarded response; report them instead.
+	return _queue_call("nvim_command", args, [p_command](const NvimRpcResponse &p_response) {
+		if (p_response.status == NvimRpcResponse::STATUS_ERROR) {
+			UtilityFunctions::printerr("[nvim_embed] :", p_command, " failed: ", _format_rpc_error(*p_response.value));
+		}
+	});
+}
 
-	char *buffer = nullptr;
-	size_t buffer_size = 0;
-	mpack_writer_t writer;
-	mpack_writer_init_growable(&writer, &buffer, &buffer_size);
-
-	uint32_t request_id = next_request_id++;
-	mpack_start_array(&writer, 4);
-	mpack_write_i32(&writer, 0);
-	mpack_write_u32(&writer, request_id);
-	mpack_write_cstr(&writer, method_utf8.get_data());
-	mpack_start_array(&writer, 6);
-	mpack_write_cstr(&writer, button_utf8.get_data());
-	mpack_write_cstr(&writer, action_utf8.get_data());
-	mpack_write_cstr(&writer, mod_utf8.get_data());
-	mpack_write_i64(&writer, p_grid);
-	mpack_write_i64(&writer, p_row);
-	mpack_write_i64(&writer, p_column);
-	mpack_finish_array(&writer);
-	mpack_finish_array(&writer);
+void NvimPanel::_track_request(uint32_t p_request_id, NvimRpcRequests::Callback p_callback) {
+	Time *time = Time::get_singleton();
+	uint64_t now_usec = time ? time->get_ticks_usec() : 0;
+	rpc_requests.add(p_request_id, std::move(p_callback), now_usec + REQUEST_TIMEOUT_USEC);
+}
 
-	mpack_error_t writer_error = mpack_writer_destroy(&writer);
-	if (writer_error != mpack_ok || !buffer || buffer_size == 0) {
-		if (buffer) {
-			std::free(buffer);
+String NvimPanel::_format_rpc_error(const mpack_node_t &p_error) {
+	// Neovim reports errors as [error_type, message]; nvim_call_atomic prefixes the call index.
+	if (mpack_node_type(p_error) == mpack_type_array && mpack_node_array_length(p_error) >= 2) {
+		mpack_node_t message_node = mpack_node_array_at(p_error, mpack_node_array_length(p_error) - 1);
+		if (mpack_node_type(message_node) == mpack_type_str) {
+			return String::utf8(mpack_node_str(message_node), static_cast<int64_t>(mpack_node_strlen(message_node)));
 		}
+	}
+	if (mpack_node_type(p_error) == mpack_type_str) {
+		return String::utf8(mpack_node_str(p_error), static_cast<int64_t>(mpack_node_strlen(p_error)));
+	}
+	return "unknown error";
+}
+
+bool NvimPanel::_send_nvim_input_mouse(const String &p_button, const String &p_action, const String &p_modifiers, int64_t p_grid, int64_t p_row, int64_t p_column) {
+	if (!nvim_client || !nvim_client->is_running()) {
 		return false;
 	}
 
-	size_t written = nvim_client->write(reinterpret_cast<const uint8_t *>(buffer), buffer_size);
-	std::free(buffer);
-	return written == buffer_size;
+	// Keys typed and wheel turned before the mouse event must reach Neovim first.
+	_flush_pending_keys();
+	_flush_pending_wheel();
+	if (!rpc_writer.notify("nvim_input_mouse", p_button, p_action, p_modifiers, p_grid, p_row, p_column)) {
+		return false;
+	}
+	++mouse_events_sent;
+	++mouse_messages_sent;
+	return true;
 }
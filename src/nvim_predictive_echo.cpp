@@ -0,0 +1,162 @@
+#include "nvim_predictive_echo.h"
+
+#include <godot_cpp/classes/global_constants.hpp>
+#include <godot_cpp/classes/rendering_server.hpp>
+#include <godot_cpp/variant/rect2.hpp>
+#include <godot_cpp/variant/transform2d.hpp>
+
+namespace godot {
+
+NvimPredictiveEcho::~NvimPredictiveEcho() {
+	release();
+}
+
+bool NvimPredictiveEcho::predict(int64_t p_grid_id, int64_t p_row, int64_t p_cursor_column, int32_t p_grid_columns, char32_t p_char, uint64_t p_now_usec) {
+	if (invalidated) {
+		return false;
+	}
+	if (!predictions.empty() && (p_grid_id != grid_id || p_row != row)) {
+		return false;
+	}
+
+	int64_t column = predictions.empty() ? p_cursor_column : predictions.back().column + 1;
+	if (column < 0 || column >= p_grid_columns) {
+		return false;
+	}
+
+	grid_id = p_grid_id;
+	row = p_row;
+	Prediction prediction;
+	prediction.column = column;
+	prediction.text = String::chr(p_char);
+	prediction.usec = p_now_usec;
+	predictions.push_back(prediction);
+	++predicted;
+	return true;
+}
+
+void NvimPredictiveEcho::note_cells_updated(int64_t p_grid_id, int64_t p_row, int64_t p_column_start, int64_t p_column_end, uint64_t p_now_usec) {
+	if (p_grid_id != grid_id || p_row != row) {
+		return;
+	}
+	for (Prediction &prediction : predictions) {
+		if (prediction.column >= p_column_start && prediction.column < p_column_end && p_now_usec >= prediction.usec) {
+			prediction.updated = true;
+		}
+	}
+}
+
+bool NvimPredictiveEcho::reconcile(const NvimGrid *p_grid, int64_t p_grid_id, int64_t p_cursor_row, uint64_t p_now_usec) {
+	bool was_invalidated = invalidated;
+	invalidated = false;
+	if (predictions.empty()) {
+		return false;
+	}
+	if (was_invalidated || !p_grid || p_grid_id != grid_id || p_cursor_row != row || row < 0 || static_cast<size_t>(row) >= p_grid->cells.size()) {
+		return rollback();
+	}
+
+	const std::vector<NvimCell> &cells = p_grid->cells[static_cast<size_t>(row)];
+	std::vector<Prediction> pending;
+	for (size_t i = 0; i < predictions.size(); ++i) {
+		const Prediction &prediction = predictions[i];
+		bool shown = prediction.updated && static_cast<size_t>(prediction.column) < cells.size() && cells[static_cast<size_t>(prediction.column)].text == prediction.text;
+		if (shown) {
+			++confirmed;
+			continue;
+		}
+		if (p_now_usec - prediction.usec >= CONFIRM_TIMEOUT_USEC) {
+			// Neovim did something else with the key (a mapping, an abbreviation); later
+			// predictions were based on this one and go too.
+			rolled_back += predictions.size() - i;
+			break;
+		}
+		pending.push_back(prediction);
+	}
+
+	bool changed = pending.size() != predictions.size();
+	predictions.swap(pending);
+	return changed;
+}
+
+bool NvimPredictiveEcho::rollback() {
+	if (predictions.empty()) {
+		return false;
+	}
+	rolled_back += predictions.size();
+	predictions.clear();
+	return true;
+}
+
+int64_t NvimPredictiveEcho::get_cursor_column() const {
+	return predictions.empty() ? 0 : predictions.back().column + 1;
+}
+
+void NvimPredictiveEcho::update(const RID &p_parent_item, NvimFontCache *p_fonts, const NvimGrid *p_grid, const NvimPalette &p_palette, const Vector2 &p_grid_origin) {
+	RenderingServer *rs = RenderingServer::get_singleton();
+	if (!rs || !p_parent_item.is_valid()) {
+		return;
+	}
+
+	if (!item.is_valid()) {
+		item = rs->canvas_item_create();
+		rs->canvas_item_set_draw_index(item, DRAW_INDEX);
+	}
+	if (parent_item != p_parent_item) {
+		parent_item = p_parent_item;
+		rs->canvas_item_set_parent(item, parent_item);
+	}
+
+	rs->canvas_item_clear(item);
+	Ref<Font> font = p_fonts ? p_fonts->get_font() : Ref<Font>();
+	if (predictions.empty() || !p_grid || !font.is_valid() || row < 0 || static_cast<size_t>(row) >= p_grid->cells.size()) {
+		rs->canvas_item_set_visible(item, false);
+		return;
+	}
+
+	const NvimFontCache::Metrics &metrics = p_fonts->get_metrics();
+	Vector2 cell_size(metrics.cell_width, metrics.cell_height);
+	const std::vector<NvimCell> &cells = p_grid->cells[static_cast<size_t>(row)];
+	int64_t row_columns = static_cast<int64_t>(cells.size());
+
+	// Predictions are inserted, so the text from the first one onward moves right by their
+	// count; whatever is pushed past the edge of the grid is clipped.
+	int64_t shift = static_cast<int64_t>(predictions.size());
+	int64_t tail_start = predictions.front().column;
+	int64_t tail_end = row_columns;
+	while (tail_end > tail_start && cells[static_cast<size_t>(tail_end - 1)].text == " " && cells[static_cast<size_t>(tail_end - 1)].hl_id == cells[static_cast<size_t>(row_columns - 1)].hl_id) {
+		--tail_end;
+	}
+	for (int64_t column = tail_start; column < tail_end && column + shift < row_columns; ++column) {
+		const NvimCell &cell = cells[static_cast<size_t>(column)];
+		Vector2 position(cell_size.x * (column + shift), cell_size.y * row);
+		rs->canvas_item_add_rect(item, Rect2(position, cell_size), p_palette.resolve_background(cell.hl_id));
+		if (cell.text != " " && !cell.text.is_empty()) {
+			font->draw_string(item, position + Vector2(0.0f, metrics.ascent), cell.text, HORIZONTAL_ALIGNMENT_LEFT, -1, p_fonts->get_font_size(), p_palette.resolve_foreground(cell.hl_id));
+		}
+	}
+
+	// Each prediction takes the colors of the cell it covers, which is usually blank text
+	// in the same highlight as the rest of the line.
+	for (const Prediction &prediction : predictions) {
+		int64_t hl_id = static_cast<size_t>(prediction.column) < cells.size() ? cells[static_cast<size_t>(prediction.column)].hl_id : 0;
+		Vector2 position(cell_size.x * prediction.column, cell_size.y * row);
+		rs->canvas_item_add_rect(item, Rect2(position, cell_size), p_palette.resolve_background(hl_id));
+		font->draw_string(item, position + Vector2(0.0f, metrics.ascent), prediction.text, HORIZONTAL_ALIGNMENT_LEFT, -1, p_fonts->get_font_size(), p_palette.resolve_foreground(hl_id));
+	}
+	rs->canvas_item_set_transform(item, Transform2D(0.0, p_grid_origin));
+	rs->canvas_item_set_visible(item, true);
+}
+
+void NvimPredictiveEcho::release() {
+	RenderingServer *rs = RenderingServer::get_singleton();
+	if (rs && item.is_valid()) {
+		rs->free_rid(item);
+	}
+	item = RID();
+	parent_item = RID();
+	predictions.clear();
+	invalidated = false;
+}
+
+} // namespace godot
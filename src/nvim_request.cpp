@@ -0,0 +1,61 @@
+#include "nvim_request.h"
+
+#include <godot_cpp/core/object.hpp>
+
+#include "nvim_panel.h"
+
+namespace godot {
+
+void NvimRequest::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("get_id"), &NvimRequest::get_id);
+	ClassDB::bind_method(D_METHOD("get_method"), &NvimRequest::get_method);
+	ClassDB::bind_method(D_METHOD("is_done"), &NvimRequest::is_done);
+	ClassDB::bind_method(D_METHOD("is_succeeded"), &NvimRequest::is_succeeded);
+	ClassDB::bind_method(D_METHOD("get_result"), &NvimRequest::get_result);
+	ClassDB::bind_method(D_METHOD("get_error"), &NvimRequest::get_error);
+	ClassDB::bind_method(D_METHOD("cancel"), &NvimRequest::cancel);
+	// Deferred target for requests that fail before they are sent, so callers can await first.
+	ClassDB::bind_method(D_METHOD("_fail", "error"), &NvimRequest::fail);
+
+	ADD_SIGNAL(MethodInfo("completed", PropertyInfo(Variant::NIL, "result", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_NIL_IS_VARIANT)));
+	ADD_SIGNAL(MethodInfo("failed", PropertyInfo(Variant::STRING, "error")));
+}
+
+void NvimRequest::setup(uint64_t p_panel_id, int64_t p_id, const String &p_method) {
+	panel_id = p_panel_id;
+	id = p_id;
+	method = p_method;
+}
+
+void NvimRequest::finish(const Variant &p_result) {
+	if (done) {
+		return;
+	}
+	done = true;
+	succeeded = true;
+	result = p_result;
+	emit_signal("completed", result);
+}
+
+void NvimRequest::fail(const String &p_error) {
+	if (done) {
+		return;
+	}
+	done = true;
+	error = p_error;
+	emit_signal("failed", error);
+}
+
+void NvimRequest::cancel() {
+	if (done) {
+		return;
+	}
+	done = true;
+	error = "cancelled";
+	NvimPanel *panel = Object::cast_to<NvimPanel>(ObjectDB::get_instance(panel_id));
+	if (panel) {
+		panel->cancel_request(id);
+	}
+}
+
+} // namespace godot
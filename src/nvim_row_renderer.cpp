@@ -0,0 +1,527 @@
+#include "nvim_row_renderer.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include <godot_cpp/classes/rendering_server.hpp>
+#include <godot_cpp/classes/text_server.hpp>
+#include <godot_cpp/classes/text_server_manager.hpp>
+#include <godot_cpp/classes/worker_thread_pool.hpp>
+#include <godot_cpp/godot.hpp>
+#include <godot_cpp/variant/rect2.hpp>
+#include <godot_cpp/variant/transform2d.hpp>
+
+namespace godot {
+
+NvimRowRenderer::~NvimRowRenderer() {
+	release();
+}
+
+void NvimRowRenderer::configure(NvimFontCache *p_fonts) {
+	if (!p_fonts) {
+		return;
+	}
+
+	const NvimFontCache::Metrics &metrics = p_fonts->get_metrics();
+	Vector2 new_cell_size(metrics.cell_width, metrics.cell_height);
+	Ref<Font> new_font = p_fonts->get_font();
+	int32_t new_font_size = p_fonts->get_font_size();
+	if (font == new_font && font_size == new_font_size && cell_size == new_cell_size && ascent == metrics.ascent) {
+		return;
+	}
+
+	bool moved = cell_size != new_cell_size;
+	font = new_font;
+	font_size = new_font_size;
+	cell_size = new_cell_size;
+	ascent = metrics.ascent;
+	shaper.configure(font, font_size, cell_size.x);
+	needs_full_redraw = true;
+	if (moved) {
+		_finish_scroll_animation();
+		needs_placement = true;
+	}
+}
+
+void NvimRowRenderer::draw(const RID &p_parent_item, NvimGrid &p_grid, const NvimPalette &p_palette) {
+	if (p_grid.columns <= 0 || p_grid.rows <= 0 || font.is_null()) {
+		return;
+	}
+
+	_resize(p_parent_item, p_grid.columns, p_grid.rows);
+	if (pending_scroll_rows != 0 && !scroll_animating) {
+		// Nobody asked for a slide, so the rows that scrolled out are simply gone.
+		_drop_ghosts();
+	}
+	pending_scroll_rows = 0;
+	if (needs_placement) {
+		_place_all();
+	}
+
+	dirty_row_list.clear();
+	for (int32_t row = 0; row < p_grid.rows && static_cast<size_t>(row) < p_grid.cells.size(); ++row) {
+		if (!needs_full_redraw && !p_grid.is_row_dirty(row)) {
+			continue;
+		}
+		// Cache hits are a single blit; only misses need their draw list built.
+		if (texture_cache && _record_cached_row(row, p_grid.cells[static_cast<size_t>(row)], p_palette)) {
+			continue;
+		}
+		dirty_row_list.push_back(row);
+	}
+	needs_full_redraw = false;
+	if (dirty_row_list.empty()) {
+		return;
+	}
+
+	int32_t tasks = dirty_row_list.size() >= PARALLEL_PREPARE_MIN_ROWS ? prepare_tasks : 1;
+	prepare_rows(p_grid, p_palette, dirty_row_list, tasks);
+	for (size_t i = 0; i < dirty_row_list.size(); ++i) {
+		_record_row(prepared_rows[i]);
+	}
+}
+
+void NvimRowRenderer::prepare_rows(const NvimGrid &p_grid, const NvimPalette &p_palette, const std::vector<int32_t> &p_rows, int32_t p_tasks) {
+	if (prepared_rows.size() < p_rows.size()) {
+		prepared_rows.resize(p_rows.size());
+	}
+
+	PrepareJob job;
+	job.renderer = this;
+	job.grid = &p_grid;
+	job.palette = &p_palette;
+	job.rows = &p_rows;
+
+	WorkerThreadPool *pool = WorkerThreadPool::get_singleton();
+	if (p_tasks == 1 || p_rows.size() < 2 || !pool) {
+		for (size_t i = 0; i < p_rows.size(); ++i) {
+			_prepare_row_task(&job, static_cast<uint32_t>(i));
+		}
+		return;
+	}
+
+	// Each task writes only its own prepared_rows slots, and the grid and palette are
+	// read-only until the group completes.
+	String description("nvim_embed row prepare");
+	int64_t group_id = pool->add_native_group_task(&NvimRowRenderer::_prepare_row_task, &job, static_cast<int>(p_rows.size()), p_tasks > 0 ? p_tasks : -1, true, description);
+	pool->wait_for_group_task_completion(group_id);
+}
+
+bool NvimRowRenderer::scroll(int32_t p_top, int32_t p_bottom, int32_t p_rows) {
+	int32_t height = p_bottom - p_top;
+	if (p_rows == 0 || p_top < 0 || p_bottom > static_cast<int32_t>(row_items.size()) || height <= 0 || std::abs(p_rows) >= height) {
+		return false;
+	}
+
+	if ((scroll_animating || !ghosts.empty()) && (p_top != scroll_top || p_bottom != scroll_bottom)) {
+		_finish_scroll_animation();
+	}
+	scroll_top = p_top;
+	scroll_bottom = p_bottom;
+
+	// The items that scroll out either become ghosts for the slide or are reused for
+	// the newly exposed rows, which the caller marks dirty.
+	RenderingServer *rs = RenderingServer::get_singleton();
+	if (smooth_scroll && rs && root_item.is_valid()) {
+		if (!scroll_clip_item.is_valid()) {
+			scroll_clip_item = rs->canvas_item_create();
+			rs->canvas_item_set_parent(scroll_clip_item, root_item);
+			rs->canvas_item_set_clip(scroll_clip_item, true);
+		}
+		_update_root();
+
+		for (Ghost &ghost : ghosts) {
+			ghost.row -= p_rows;
+		}
+		int32_t out_begin = p_rows > 0 ? p_top : p_bottom + p_rows;
+		int32_t out_end = out_begin + std::abs(p_rows);
+		for (int32_t row = out_begin; row < out_end; ++row) {
+			Ghost ghost;
+			ghost.item = row_items[static_cast<size_t>(row)];
+			ghost.texture = row_textures[static_cast<size_t>(row)];
+			ghost.row = row - p_rows;
+			rs->canvas_item_set_parent(ghost.item, scroll_clip_item);
+			ghosts.push_back(ghost);
+
+			RID item = rs->canvas_item_create();
+			rs->canvas_item_set_parent(item, scroll_animating ? scroll_clip_item : root_item);
+			row_items[static_cast<size_t>(row)] = item;
+			row_textures[static_cast<size_t>(row)].unref();
+		}
+		pending_scroll_rows += p_rows;
+	}
+
+	auto first = row_items.begin() + p_top;
+	auto last = row_items.begin() + p_bottom;
+	auto first_texture = row_textures.begin() + p_top;
+	auto last_texture = row_textures.begin() + p_bottom;
+	if (p_rows > 0) {
+		std::rotate(first, first + p_rows, last);
+		std::rotate(first_texture, first_texture + p_rows, last_texture);
+	} else {
+		std::rotate(first, last + p_rows, last);
+		std::rotate(first_texture, last_texture + p_rows, last_texture);
+	}
+	shaper.scroll(p_top, p_bottom, p_rows);
+	needs_placement = true;
+	return true;
+}
+
+void NvimRowRenderer::invalidate() {
+	needs_full_redraw = true;
+}
+
+void NvimRowRenderer::set_texture_cache(NvimRowTextureCache *p_cache) {
+	if (texture_cache != p_cache) {
+		texture_cache = p_cache;
+		needs_full_redraw = true;
+	}
+}
+
+void NvimRowRenderer::set_placement(const Vector2 &p_origin, int32_t p_draw_index, bool p_visible) {
+	if (origin == p_origin && draw_index == p_draw_index && visible == p_visible) {
+		return;
+	}
+	origin = p_origin;
+	draw_index = p_draw_index;
+	visible = p_visible;
+	_update_root();
+}
+
+void NvimRowRenderer::set_smooth_scroll(bool p_enabled) {
+	if (smooth_scroll == p_enabled) {
+		return;
+	}
+	smooth_scroll = p_enabled;
+	if (!smooth_scroll) {
+		_finish_scroll_animation();
+	}
+}
+
+bool NvimRowRenderer::animate_pending_scroll(double p_duration) {
+	RenderingServer *rs = RenderingServer::get_singleton();
+	if (!rs || !smooth_scroll || pending_scroll_rows == 0 || p_duration <= 0.0 || !scroll_clip_item.is_valid()) {
+		return false;
+	}
+
+	if (!scroll_animating) {
+		for (int32_t row = scroll_top; row < scroll_bottom && static_cast<size_t>(row) < row_items.size(); ++row) {
+			rs->canvas_item_set_parent(row_items[static_cast<size_t>(row)], scroll_clip_item);
+		}
+		scroll_animating = true;
+		scroll_offset = 0.0f;
+	}
+
+	// Rows start where their content was on screen and ease towards their grid position.
+	scroll_start_offset = scroll_offset + cell_size.y * pending_scroll_rows;
+	scroll_offset = scroll_start_offset;
+	scroll_elapsed = 0.0;
+	scroll_duration = p_duration;
+	pending_scroll_rows = 0;
+	needs_placement = true;
+	return true;
+}
+
+bool NvimRowRenderer::process_scroll_animation(double p_delta) {
+	if (!scroll_animating) {
+		return false;
+	}
+	if (needs_placement) {
+		// The scroll has not been drawn yet; start the clock with the first frame that shows it.
+		return true;
+	}
+
+	scroll_elapsed += p_delta;
+	double t = scroll_duration > 0.0 ? std::min(1.0, scroll_elapsed / scroll_duration) : 1.0;
+	if (t >= 1.0) {
+		_finish_scroll_animation();
+		return false;
+	}
+
+	double remaining = 1.0 - t;
+	scroll_offset = static_cast<float>(scroll_start_offset * remaining * remaining * remaining);
+
+	// Ghosts only move further out of the region from here on, so clipped ones can go.
+	RenderingServer *rs = RenderingServer::get_singleton();
+	float region_top = cell_size.y * scroll_top;
+	float region_bottom = cell_size.y * scroll_bottom;
+	for (size_t i = 0; i < ghosts.size();) {
+		float y = cell_size.y * ghosts[i].row + scroll_offset;
+		if (rs && (y + cell_size.y <= region_top || y >= region_bottom)) {
+			rs->free_rid(ghosts[i].item);
+			ghosts[i] = ghosts.back();
+			ghosts.pop_back();
+			continue;
+		}
+		++i;
+	}
+	_place_all();
+	return true;
+}
+
+float NvimRowRenderer::get_row_offset(int32_t p_row) const {
+	return scroll_animating && _in_scroll_region(p_row) ? scroll_offset : 0.0f;
+}
+
+void NvimRowRenderer::release() {
+	_finish_scroll_animation();
+	RenderingServer *rs = RenderingServer::get_singleton();
+	if (rs) {
+		for (const RID &item : row_items) {
+			if (item.is_valid()) {
+				rs->free_rid(item);
+			}
+		}
+		if (scroll_clip_item.is_valid()) {
+			rs->free_rid(scroll_clip_item);
+		}
+		if (root_item.is_valid()) {
+			rs->free_rid(root_item);
+		}
+	}
+	row_items.clear();
+	row_textures.clear();
+	shaper.resize(0);
+	scroll_clip_item = RID();
+	root_item = RID();
+	parent_item = RID();
+	columns = 0;
+	needs_full_redraw = true;
+	needs_placement = false;
+}
+
+void NvimRowRenderer::_resize(const RID &p_parent_item, int32_t p_columns, int32_t p_rows) {
+	RenderingServer *rs = RenderingServer::get_singleton();
+	if (!rs) {
+		return;
+	}
+
+	if (parent_item != p_parent_item || columns != p_columns) {
+		release();
+		parent_item = p_parent_item;
+		columns = p_columns;
+		root_item = rs->canvas_item_create();
+		rs->canvas_item_set_parent(root_item, parent_item);
+		rs->canvas_item_set_clip(root_item, true);
+	}
+
+	size_t old_count = row_items.size();
+	if (old_count == static_cast<size_t>(p_rows)) {
+		return;
+	}
+
+	_finish_scroll_animation();
+	for (size_t row = static_cast<size_t>(p_rows); row < old_count; ++row) {
+		rs->free_rid(row_items[row]);
+	}
+	row_items.resize(static_cast<size_t>(p_rows));
+	row_textures.resize(static_cast<size_t>(p_rows));
+	shaper.resize(p_rows);
+	for (size_t row = old_count; row < row_items.size(); ++row) {
+		RID item = rs->canvas_item_create();
+		rs->canvas_item_set_parent(item, root_item);
+		row_items[row] = item;
+	}
+	needs_full_redraw = true;
+	needs_placement = true;
+}
+
+void NvimRowRenderer::_place_row(int32_t p_row) {
+	RenderingServer *rs = RenderingServer::get_singleton();
+	if (!rs || p_row < 0 || static_cast<size_t>(p_row) >= row_items.size()) {
+		return;
+	}
+	float y = cell_size.y * p_row;
+	if (scroll_animating && _in_scroll_region(p_row)) {
+		y += scroll_offset;
+	}
+	rs->canvas_item_set_transform(row_items[static_cast<size_t>(p_row)], Transform2D(0.0, Vector2(0.0f, y)));
+}
+
+void NvimRowRenderer::_place_all() {
+	RenderingServer *rs = RenderingServer::get_singleton();
+	if (!rs) {
+		return;
+	}
+
+	int32_t first = 0;
+	int32_t last = static_cast<int32_t>(row_items.size());
+	if (!needs_placement) {
+		// Animation frames only move the scroll region.
+		first = scroll_top;
+		last = std::min(scroll_bottom, last);
+	}
+	for (int32_t row = first; row < last; ++row) {
+		_place_row(row);
+	}
+	for (const Ghost &ghost : ghosts) {
+		rs->canvas_item_set_transform(ghost.item, Transform2D(0.0, Vector2(0.0f, cell_size.y * ghost.row + scroll_offset)));
+	}
+	if (needs_placement) {
+		_update_root();
+	}
+	needs_placement = false;
+}
+
+void NvimRowRenderer::_update_root() {
+	RenderingServer *rs = RenderingServer::get_singleton();
+	if (!rs || !root_item.is_valid()) {
+		return;
+	}
+
+	Vector2 size(cell_size.x * columns, cell_size.y * static_cast<float>(row_items.size()));
+	rs->canvas_item_set_transform(root_item, Transform2D(0.0, origin));
+	rs->canvas_item_set_draw_index(root_item, draw_index);
+	rs->canvas_item_set_visible(root_item, visible);
+	rs->canvas_item_set_custom_rect(root_item, true, Rect2(Vector2(), size));
+	if (scroll_clip_item.is_valid()) {
+		Rect2 region(Vector2(0.0f, cell_size.y * scroll_top), Vector2(size.x, cell_size.y * (scroll_bottom - scroll_top)));
+		rs->canvas_item_set_custom_rect(scroll_clip_item, true, region);
+	}
+}
+
+void NvimRowRenderer::_finish_scroll_animation() {
+	RenderingServer *rs = RenderingServer::get_singleton();
+	bool was_animating = scroll_animating;
+	if (rs && scroll_animating) {
+		for (int32_t row = scroll_top; row < scroll_bottom && static_cast<size_t>(row) < row_items.size(); ++row) {
+			rs->canvas_item_set_parent(row_items[static_cast<size_t>(row)], root_item);
+		}
+	}
+	scroll_animating = false;
+	scroll_offset = 0.0f;
+	scroll_start_offset = 0.0f;
+	pending_scroll_rows = 0;
+	_drop_ghosts();
+	if (was_animating) {
+		for (int32_t row = scroll_top; row < scroll_bottom; ++row) {
+			_place_row(row);
+		}
+	}
+}
+
+void NvimRowRenderer::_drop_ghosts() {
+	RenderingServer *rs = RenderingServer::get_singleton();
+	if (rs) {
+		for (const Ghost &ghost : ghosts) {
+			rs->free_rid(ghost.item);
+		}
+	}
+	ghosts.clear();
+}
+
+bool NvimRowRenderer::_in_scroll_region(int32_t p_row) const {
+	return p_row >= scroll_top && p_row < scroll_bottom;
+}
+
+bool NvimRowRenderer::_record_cached_row(int32_t p_row, const std::vector<NvimCell> &p_cells, const NvimPalette &p_palette) {
+	RenderingServer *rs = RenderingServer::get_singleton();
+	if (!rs) {
+		return false;
+	}
+
+	Ref<ImageTexture> texture = texture_cache->acquire(p_cells, columns, p_palette);
+	if (texture.is_null()) {
+		return false;
+	}
+
+	const RID &item = row_items[static_cast<size_t>(p_row)];
+	rs->canvas_item_clear(item);
+	row_textures[static_cast<size_t>(p_row)] = texture;
+	++rows_recorded;
+	Rect2 rect(Vector2(), Vector2(texture->get_width(), texture->get_height()));
+	rs->canvas_item_add_texture_rect(item, rect, texture->get_rid());
+	return true;
+}
+
+void NvimRowRenderer::_record_row(PreparedRow &p_prepared) {
+	RenderingServer *rs = RenderingServer::get_singleton();
+	if (!rs) {
+		return;
+	}
+
+	const RID &item = row_items[static_cast<size_t>(p_prepared.row)];
+	rs->canvas_item_clear(item);
+	row_textures[static_cast<size_t>(p_prepared.row)].unref();
+	++rows_recorded;
+
+	for (size_t i = 0; i < p_prepared.background_rects.size(); ++i) {
+		rs->canvas_item_add_rect(item, p_prepared.background_rects[i], p_prepared.background_colors[i]);
+	}
+
+	// Replays the row's cached glyph buffer; shaping only happens when the row's text changed.
+	TextServerManager *ts_manager = TextServerManager::get_singleton();
+	Ref<TextServer> ts = ts_manager ? ts_manager->get_primary_interface() : Ref<TextServer>();
+	if (ts.is_valid()) {
+		const std::vector<NvimRowShaper::Glyph> &glyphs = shaper.shape_text(p_prepared.row, p_prepared.text);
+		for (const NvimRowShaper::Glyph &glyph : glyphs) {
+			const Color &fg = p_prepared.foregrounds[static_cast<size_t>(glyph.column)];
+			ts->font_draw_glyph(glyph.font_rid, item, font_size, glyph.position + Vector2(0.0f, ascent), glyph.index, fg);
+		}
+	}
+
+	for (size_t i = 0; i < p_prepared.line_colors.size(); ++i) {
+		rs->canvas_item_add_line(item, p_prepared.line_points[2 * i], p_prepared.line_points[2 * i + 1], p_prepared.line_colors[i]);
+	}
+}
+
+void NvimRowRenderer::_prepare_row(PreparedRow &r_prepared, const std::vector<NvimCell> &p_cells, int32_t p_columns, const NvimPalette &p_palette) const {
+	r_prepared.background_rects.clear();
+	r_prepared.background_colors.clear();
+	r_prepared.line_points.clear();
+	r_prepared.line_colors.clear();
+
+	// Backgrounds are merged into runs; the default background is already drawn by the canvas.
+	int32_t cell_count = std::min(p_columns, static_cast<int32_t>(p_cells.size()));
+	int32_t run_start = 0;
+	Color run_color;
+	for (int32_t col = 0; col <= cell_count; ++col) {
+		Color bg;
+		if (col < cell_count) {
+			bg = p_palette.resolve_background(p_cells[static_cast<size_t>(col)].hl_id);
+		}
+		if (col > 0 && (col == cell_count || bg != run_color)) {
+			if (run_color.a > 0.0f && run_color != p_palette.default_background) {
+				r_prepared.background_rects.push_back(Rect2(Vector2(cell_size.x * run_start, 0.0f), Vector2(cell_size.x * (col - run_start), cell_size.y)));
+				r_prepared.background_colors.push_back(run_color);
+			}
+			run_start = col;
+		}
+		run_color = bg;
+	}
+
+	r_prepared.foregrounds.resize(static_cast<size_t>(std::max(cell_count, 0)));
+	for (int32_t col = 0; col < cell_count; ++col) {
+		const NvimCell &cell = p_cells[static_cast<size_t>(col)];
+		Color fg = p_palette.resolve_foreground(cell.hl_id);
+		r_prepared.foregrounds[static_cast<size_t>(col)] = fg;
+		float x = cell_size.x * col;
+		uint32_t attributes = p_palette.resolve_attributes(cell.hl_id);
+		if (attributes & (NVIM_HL_UNDERLINE | NVIM_HL_UNDERCURL)) {
+			float underline_y = cell_size.y - 0.5f;
+			r_prepared.line_points.push_back(Vector2(x, underline_y));
+			r_prepared.line_points.push_back(Vector2(x + cell_size.x, underline_y));
+			r_prepared.line_colors.push_back(fg);
+		}
+		if (attributes & NVIM_HL_STRIKETHROUGH) {
+			float strike_y = cell_size.y * 0.5f;
+			r_prepared.line_points.push_back(Vector2(x, strike_y));
+			r_prepared.line_points.push_back(Vector2(x + cell_size.x, strike_y));
+			r_prepared.line_colors.push_back(fg);
+		}
+	}
+
+	NvimRowShaper::build_text(p_cells, p_columns, r_prepared.text);
+}
+
+void NvimRowRenderer::_prepare_row_task(void *p_userdata, uint32_t p_index) {
+	static const std::vector<NvimCell> no_cells;
+	PrepareJob *job = static_cast<PrepareJob *>(p_userdata);
+	int32_t row = (*job->rows)[p_index];
+	PreparedRow &prepared = job->renderer->prepared_rows[p_index];
+	prepared.row = row;
+	const std::vector<NvimCell> &cells = row >= 0 && static_cast<size_t>(row) < job->grid->cells.size() ? job->grid->cells[static_cast<size_t>(row)] : no_cells;
+	job->renderer->_prepare_row(prepared, cells, job->grid->columns, *job->palette);
+}
+
+} // namespace godot
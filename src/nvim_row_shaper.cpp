@@ -0,0 +1,195 @@
+#include "nvim_row_shaper.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include <godot_cpp/classes/text_server.hpp>
+#include <godot_cpp/classes/text_server_manager.hpp>
+#include <godot_cpp/variant/dictionary.hpp>
+#include <godot_cpp/variant/typed_array.hpp>
+
+namespace godot {
+
+namespace {
+constexpr uint64_t FNV_OFFSET = 14695981039346656037ULL;
+constexpr uint64_t FNV_PRIME = 1099511628211ULL;
+
+Ref<TextServer> _get_text_server() {
+	TextServerManager *ts_manager = TextServerManager::get_singleton();
+	if (!ts_manager) {
+		return Ref<TextServer>();
+	}
+	return ts_manager->get_primary_interface();
+}
+} // namespace
+
+NvimRowShaper::~NvimRowShaper() {
+	clear();
+	rows.clear();
+}
+
+void NvimRowShaper::configure(const Ref<Font> &p_font, int32_t p_font_size, float p_cell_width) {
+	if (font == p_font && font_size == p_font_size && cell_width == p_cell_width) {
+		return;
+	}
+
+	font = p_font;
+	font_size = p_font_size;
+	cell_width = p_cell_width;
+	clear();
+}
+
+void NvimRowShaper::resize(int32_t p_rows) {
+	size_t new_size = static_cast<size_t>(std::max(p_rows, 0));
+	for (size_t row = new_size; row < rows.size(); ++row) {
+		_free_row(rows[row]);
+	}
+	rows.resize(new_size);
+}
+
+void NvimRowShaper::scroll(int32_t p_top, int32_t p_bottom, int32_t p_rows) {
+	int32_t height = p_bottom - p_top;
+	if (p_rows == 0 || p_top < 0 || p_bottom > static_cast<int32_t>(rows.size()) || height <= 0 || std::abs(p_rows) >= height) {
+		return;
+	}
+
+	auto first = rows.begin() + p_top;
+	auto last = rows.begin() + p_bottom;
+	std::rotate(first, p_rows > 0 ? first + p_rows : last + p_rows, last);
+}
+
+void NvimRowShaper::clear() {
+	for (ShapedRow &row : rows) {
+		_free_row(row);
+	}
+}
+
+void NvimRowShaper::build_text(const std::vector<NvimCell> &p_cells, int32_t p_columns, RowText &r_text) {
+	int32_t cell_count = std::min(p_columns, static_cast<int32_t>(p_cells.size()));
+	std::vector<char32_t> &characters = r_text.characters;
+	std::vector<int32_t> &column_of_char = r_text.column_of_char;
+	characters.clear();
+	column_of_char.clear();
+	characters.reserve(static_cast<size_t>(std::max(cell_count, 0)) + 1);
+	column_of_char.reserve(static_cast<size_t>(std::max(cell_count, 0)));
+	uint64_t hash = FNV_OFFSET;
+	for (int32_t col = 0; col < cell_count; ++col) {
+		const String &text = p_cells[static_cast<size_t>(col)].text;
+		int64_t length = text.length();
+		if (length == 0) {
+			characters.push_back(U' ');
+			column_of_char.push_back(col);
+		}
+		for (int64_t i = 0; i < length; ++i) {
+			characters.push_back(text[i]);
+			column_of_char.push_back(col);
+		}
+		hash = (hash ^ static_cast<uint64_t>(characters.size())) * FNV_PRIME;
+	}
+	for (char32_t character : characters) {
+		hash = (hash ^ static_cast<uint64_t>(character)) * FNV_PRIME;
+	}
+	r_text.hash = hash;
+}
+
+const std::vector<NvimRowShaper::Glyph> &NvimRowShaper::shape(int32_t p_row, const std::vector<NvimCell> &p_cells, int32_t p_columns) {
+	build_text(p_cells, p_columns, scratch_text);
+	return shape_text(p_row, scratch_text);
+}
+
+const std::vector<NvimRowShaper::Glyph> &NvimRowShaper::shape_text(int32_t p_row, RowText &p_text) {
+	static const std::vector<Glyph> empty;
+	if (p_row < 0 || static_cast<size_t>(p_row) >= rows.size() || font.is_null()) {
+		return empty;
+	}
+
+	const std::vector<char32_t> &characters = p_text.characters;
+	const std::vector<int32_t> &column_of_char = p_text.column_of_char;
+	uint64_t hash = p_text.hash;
+
+	ShapedRow &shaped_row = rows[static_cast<size_t>(p_row)];
+	if (shaped_row.valid && shaped_row.text_hash == hash && shaped_row.characters == characters && shaped_row.column_of_char == column_of_char) {
+		++rows_reused;
+		return shaped_row.glyphs;
+	}
+
+	shaped_row.glyphs.clear();
+	shaped_row.text_hash = hash;
+	shaped_row.characters = characters;
+	shaped_row.column_of_char = column_of_char;
+	shaped_row.valid = true;
+	++rows_shaped;
+
+	Ref<TextServer> ts = _get_text_server();
+	if (ts.is_null()) {
+		return shaped_row.glyphs;
+	}
+
+	if (shaped_row.shaped_text.is_valid()) {
+		ts->shaped_text_clear(shaped_row.shaped_text);
+	} else {
+		shaped_row.shaped_text = ts->create_shaped_text();
+	}
+
+	p_text.characters.push_back(0);
+	String row_string(characters.data());
+	p_text.characters.pop_back();
+	ts->shaped_text_add_string(shaped_row.shaped_text, row_string, font->get_rids(), font_size);
+	ts->shaped_text_shape(shaped_row.shaped_text);
+	TypedArray<Dictionary> glyph_data = ts->shaped_text_get_glyphs(shaped_row.shaped_text);
+
+	// Glyphs snap to the grid by their cluster's column; marks within a cluster keep
+	// their shaped advances so combining characters and ligatures still line up.
+	int64_t cluster_start = -1;
+	float pen_x = 0.0f;
+	shaped_row.glyphs.reserve(static_cast<size_t>(glyph_data.size()));
+	for (int64_t i = 0; i < glyph_data.size(); ++i) {
+		Dictionary glyph = glyph_data[i];
+		int64_t start = glyph["start"];
+		if (start < 0 || static_cast<size_t>(start) >= column_of_char.size()) {
+			continue;
+		}
+
+		int32_t column = column_of_char[static_cast<size_t>(start)];
+		if (start != cluster_start) {
+			cluster_start = start;
+			pen_x = cell_width * column;
+		}
+
+		RID font_rid = glyph["font_rid"];
+		int64_t index = glyph["index"];
+		Vector2 offset = glyph["offset"];
+		float advance = glyph["advance"];
+		int64_t repeat = std::max<int64_t>(1, glyph["repeat"]);
+		bool blank = characters[static_cast<size_t>(start)] == U' ';
+		for (int64_t r = 0; r < repeat; ++r) {
+			if (!blank && font_rid.is_valid() && index != 0) {
+				Glyph shaped_glyph;
+				shaped_glyph.font_rid = font_rid;
+				shaped_glyph.index = index;
+				shaped_glyph.column = column;
+				shaped_glyph.position = Vector2(pen_x, 0.0f) + offset;
+				shaped_row.glyphs.push_back(shaped_glyph);
+			}
+			pen_x += advance;
+		}
+	}
+
+	return shaped_row.glyphs;
+}
+
+void NvimRowShaper::_free_row(ShapedRow &p_row) {
+	if (p_row.shaped_text.is_valid()) {
+		Ref<TextServer> ts = _get_text_server();
+		if (ts.is_valid()) {
+			ts->free_rid(p_row.shaped_text);
+		}
+	}
+	p_row.shaped_text = RID();
+	p_row.valid = false;
+	p_row.glyphs.clear();
+	p_row.characters.clear();
+	p_row.column_of_char.clear();
+}
+
+} // namespace godot
@@ -0,0 +1,209 @@
+#include "nvim_row_texture_cache.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <godot_cpp/classes/image.hpp>
+#include <godot_cpp/variant/packed_byte_array.hpp>
+
+namespace godot {
+
+namespace {
+constexpr uint64_t FNV_OFFSET = 14695981039346656037ULL;
+constexpr uint64_t FNV_PRIME = 1099511628211ULL;
+
+void _hash_u32(uint64_t &r_hash, uint32_t p_value) {
+	for (int i = 0; i < 4; ++i) {
+		r_hash ^= (p_value >> (i * 8)) & 0xFF;
+		r_hash *= FNV_PRIME;
+	}
+}
+
+uint8_t _to_byte(float p_value) {
+	return static_cast<uint8_t>(std::clamp(p_value * 255.0f + 0.5f, 0.0f, 255.0f));
+}
+} // namespace
+
+void NvimRowTextureCache::configure(NvimFontCache *p_fonts) {
+	if (!p_fonts) {
+		return;
+	}
+
+	const NvimFontCache::Metrics &metrics = p_fonts->get_metrics();
+	Vector2 new_cell_size(metrics.cell_width, metrics.cell_height);
+	uint64_t generation = atlas.get_generation();
+	atlas.configure(p_fonts);
+	if (atlas.get_generation() != generation || cell_size != new_cell_size) {
+		cell_size = new_cell_size;
+		clear();
+	}
+}
+
+void NvimRowTextureCache::set_memory_limit(int64_t p_bytes) {
+	memory_limit = std::max<int64_t>(p_bytes, 0);
+	_evict_to(memory_limit);
+}
+
+void NvimRowTextureCache::clear() {
+	entries.clear();
+	lookup.clear();
+	memory_used = 0;
+}
+
+Ref<ImageTexture> NvimRowTextureCache::acquire(const std::vector<NvimCell> &p_cells, int32_t p_columns, const NvimPalette &p_palette) {
+	if (memory_limit <= 0) {
+		return Ref<ImageTexture>();
+	}
+
+	uint64_t key = _build_key(p_cells, p_columns, p_palette);
+	auto found = lookup.find(key);
+	if (found != lookup.end()) {
+		if (found->second->words == key_words) {
+			++hits;
+			entries.splice(entries.begin(), entries, found->second);
+			return found->second->texture;
+		}
+		// A hash collision: the newer row takes the slot.
+		memory_used -= found->second->bytes;
+		entries.erase(found->second);
+		lookup.erase(found);
+	}
+
+	++misses;
+	Ref<ImageTexture> texture = _rasterize_row(p_cells, p_columns, p_palette);
+	if (texture.is_null()) {
+		return texture;
+	}
+
+	Entry entry;
+	entry.key = key;
+	entry.words = key_words;
+	entry.texture = texture;
+	entry.bytes = static_cast<int64_t>(texture->get_width()) * texture->get_height() * 4;
+	if (entry.bytes > memory_limit) {
+		return texture;
+	}
+
+	_evict_to(memory_limit - entry.bytes);
+	entries.push_front(entry);
+	lookup[key] = entries.begin();
+	memory_used += entry.bytes;
+	return texture;
+}
+
+uint64_t NvimRowTextureCache::_build_key(const std::vector<NvimCell> &p_cells, int32_t p_columns, const NvimPalette &p_palette) {
+	// Keyed on resolved colors rather than hl ids, so a palette change simply misses.
+	key_words.clear();
+	key_words.push_back(static_cast<uint32_t>(p_columns));
+	int32_t cell_count = std::min(p_columns, static_cast<int32_t>(p_cells.size()));
+	for (int32_t col = 0; col < cell_count; ++col) {
+		const NvimCell &cell = p_cells[static_cast<size_t>(col)];
+		for (int64_t i = 0; i < cell.text.length(); ++i) {
+			key_words.push_back(static_cast<uint32_t>(cell.text[i]));
+		}
+		key_words.push_back(0);
+		key_words.push_back(p_palette.resolve_foreground(cell.hl_id).to_rgba32());
+		key_words.push_back(p_palette.resolve_background(cell.hl_id).to_rgba32());
+		key_words.push_back(p_palette.resolve_attributes(cell.hl_id));
+	}
+
+	uint64_t hash = FNV_OFFSET;
+	for (uint32_t word : key_words) {
+		_hash_u32(hash, word);
+	}
+	return hash;
+}
+
+Ref<ImageTexture> NvimRowTextureCache::_rasterize_row(const std::vector<NvimCell> &p_cells, int32_t p_columns, const NvimPalette &p_palette) {
+	int32_t cell_count = std::min(p_columns, static_cast<int32_t>(p_cells.size()));
+	if (cell_count <= 0) {
+		return Ref<ImageTexture>();
+	}
+
+	std::vector<char32_t> codepoints;
+	for (int32_t col = 0; col < cell_count; ++col) {
+		const String &text = p_cells[static_cast<size_t>(col)].text;
+		if (text.is_empty()) {
+			continue;
+		}
+		char32_t key = text[0] | (NvimGrid::is_wide_cell(p_cells, static_cast<size_t>(col)) ? NvimGlyphAtlas::WIDE_GLYPH : 0);
+		if (atlas.find_slot(key) == 0) {
+			codepoints.push_back(key);
+		}
+	}
+	atlas.add_codepoints(codepoints);
+
+	const Vector2i slot_size = atlas.get_slot_size();
+	const Vector2i atlas_size = atlas.get_image_size();
+	const uint8_t *atlas_pixels = atlas.get_pixels().ptr();
+	const int32_t width = std::max(1, static_cast<int32_t>(std::ceil(cell_size.x * p_columns)));
+	const int32_t height = slot_size.y;
+
+	PackedByteArray pixels;
+	pixels.resize(static_cast<int64_t>(width) * height * 4);
+	pixels.fill(0);
+	uint8_t *dst = pixels.ptrw();
+
+	uint32_t continuation_slot = 0;
+	for (int32_t col = 0; col < p_columns; ++col) {
+		int32_t x0 = static_cast<int32_t>(std::lround(cell_size.x * col));
+		int32_t x1 = std::min(width, static_cast<int32_t>(std::lround(cell_size.x * (col + 1))));
+		Color fg = p_palette.default_foreground;
+		Color bg = p_palette.default_background;
+		uint32_t slot = 0;
+		uint32_t attributes = 0;
+		if (col < cell_count) {
+			const NvimCell &cell = p_cells[static_cast<size_t>(col)];
+			fg = p_palette.resolve_foreground(cell.hl_id);
+			bg = p_palette.resolve_background(cell.hl_id);
+			attributes = p_palette.resolve_attributes(cell.hl_id);
+			// The right half of a wide glyph copies the slot after its left half.
+			slot = continuation_slot;
+			continuation_slot = 0;
+			if (!cell.text.is_empty()) {
+				bool wide = NvimGrid::is_wide_cell(p_cells, static_cast<size_t>(col));
+				slot = atlas.find_slot(cell.text[0] | (wide ? NvimGlyphAtlas::WIDE_GLYPH : 0));
+				continuation_slot = (wide && slot != 0) ? slot + 1 : 0;
+			}
+		}
+
+		const uint8_t fg_bytes[4] = { _to_byte(fg.r), _to_byte(fg.g), _to_byte(fg.b), _to_byte(fg.a) };
+		const uint8_t bg_bytes[4] = { _to_byte(bg.r), _to_byte(bg.g), _to_byte(bg.b), _to_byte(bg.a) };
+		const int32_t slot_x = static_cast<int32_t>(slot % NvimGlyphAtlas::SLOTS_PER_ROW) * slot_size.x;
+		const int32_t slot_y = static_cast<int32_t>(slot / NvimGlyphAtlas::SLOTS_PER_ROW) * slot_size.y;
+
+		for (int32_t y = 0; y < height; ++y) {
+			bool line = ((attributes & (NVIM_HL_UNDERLINE | NVIM_HL_UNDERCURL)) && y == height - 1) || ((attributes & NVIM_HL_STRIKETHROUGH) && y == height / 2);
+			for (int32_t x = x0; x < x1; ++x) {
+				uint32_t coverage = 0;
+				int32_t gx = x - x0;
+				if (line) {
+					coverage = 255;
+				} else if (slot != 0 && gx < slot_size.x && slot_x + gx < atlas_size.x && slot_y + y < atlas_size.y) {
+					coverage = atlas_pixels[(static_cast<size_t>(slot_y + y) * atlas_size.x + slot_x + gx) * 4 + 3];
+					coverage = coverage * fg_bytes[3] / 255;
+				}
+
+				uint8_t *texel = dst + (static_cast<size_t>(y) * width + x) * 4;
+				for (int channel = 0; channel < 3; ++channel) {
+					texel[channel] = static_cast<uint8_t>((bg_bytes[channel] * (255 - coverage) + fg_bytes[channel] * coverage) / 255);
+				}
+				texel[3] = static_cast<uint8_t>(std::max<uint32_t>(bg_bytes[3], coverage));
+			}
+		}
+	}
+
+	Ref<Image> image = Image::create_from_data(width, height, false, Image::FORMAT_RGBA8, pixels);
+	return ImageTexture::create_from_image(image);
+}
+
+void NvimRowTextureCache::_evict_to(int64_t p_bytes) {
+	while (!entries.empty() && memory_used > p_bytes) {
+		const Entry &oldest = entries.back();
+		memory_used -= oldest.bytes;
+		lookup.erase(oldest.key);
+		entries.pop_back();
+	}
+}
+
+} // namespace godot
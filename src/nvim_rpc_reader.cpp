@@ -0,0 +1,358 @@
+#include "nvim_rpc_reader.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <poll.h>
+#include <unistd.h>
+
+namespace godot {
+
+namespace {
+// How often the worker re-checks for stop() while the pipe is idle.
+constexpr int READ_POLL_TIMEOUT_MS = 50;
+constexpr size_t READ_BUFFER_SIZE = 16384;
+constexpr size_t MESSAGE_INVALID = SIZE_MAX;
+
+bool read_length(const uint8_t *p_data, size_t p_length, size_t &r_offset, size_t p_bytes, uint64_t &r_value) {
+	if (p_length - r_offset < p_bytes) {
+		return false;
+	}
+	r_value = 0;
+	for (size_t i = 0; i < p_bytes; ++i) {
+		r_value = (r_value << 8) | p_data[r_offset + i];
+	}
+	r_offset += p_bytes;
+	return true;
+}
+
+// Size of the first complete MessagePack object in the data, 0 when more bytes are needed,
+// or MESSAGE_INVALID. mpack's data trees report a truncated message as invalid, so the
+// reader frames messages itself before handing exact slices to the tree parser.
+size_t measure_message(const uint8_t *p_data, size_t p_length) {
+	size_t offset = 0;
+	uint64_t pending = 1;
+	while (pending > 0) {
+		if (offset >= p_length) {
+			return 0;
+		}
+		uint8_t tag = p_data[offset++];
+		--pending;
+
+		uint64_t skip = 0;
+		uint64_t children = 0;
+		uint64_t length = 0;
+		if (tag <= 0x7f || tag >= 0xe0) {
+			// fixint
+		} else if (tag <= 0x8f) {
+			children = 2 * static_cast<uint64_t>(tag & 0x0f);
+		} else if (tag <= 0x9f) {
+			children = tag & 0x0f;
+		} else if (tag <= 0xbf) {
+			skip = tag & 0x1f;
+		} else {
+			switch (tag) {
+				case 0xc0: // nil
+				case 0xc2: // false
+				case 0xc3: // true
+					break;
+				case 0xc4: // bin 8
+				case 0xd9: // str 8
+				case 0xc5: // bin 16
+				case 0xda: // str 16
+				case 0xc6: // bin 32
+				case 0xdb: { // str 32
+					size_t bytes = (tag == 0xc4 || tag == 0xd9) ? 1 : ((tag == 0xc5 || tag == 0xda) ? 2 : 4);
+					if (!read_length(p_data, p_length, offset, bytes, length)) {
+						return 0;
+					}
+					skip = length;
+				} break;
+				case 0xc7: // ext 8
+				case 0xc8: // ext 16
+				case 0xc9: { // ext 32
+					size_t bytes = tag == 0xc7 ? 1 : (tag == 0xc8 ? 2 : 4);
+					if (!read_length(p_data, p_length, offset, bytes, length)) {
+						return 0;
+					}
+					skip = length + 1;
+				} break;
+				case 0xcc: // uint 8
+				case 0xd0: // int 8
+					skip = 1;
+					break;
+				case 0xcd: // uint 16
+				case 0xd1: // int 16
+					skip = 2;
+					break;
+				case 0xca: // float 32
+				case 0xce: // uint 32
+				case 0xd2: // int 32
+					skip = 4;
+					break;
+				case 0xcb: // float 64
+				case 0xcf: // uint 64
+				case 0xd3: // int 64
+					skip = 8;
+					break;
+				case 0xd4: // fixext 1, 2, 4, 8, 16 (plus the type byte)
+					skip = 2;
+					break;
+				case 0xd5:
+					skip = 3;
+					break;
+				case 0xd6:
+					skip = 5;
+					break;
+				case 0xd7:
+					skip = 9;
+					break;
+				case 0xd8:
+					skip = 17;
+					break;
+				case 0xdc: // array 16
+				case 0xdd: // array 32
+				case 0xde: // map 16
+				case 0xdf: { // map 32
+					size_t bytes = (tag == 0xdc || tag == 0xde) ? 2 : 4;
+					if (!read_length(p_data, p_length, offset, bytes, length)) {
+						return 0;
+					}
+					children = (tag == 0xde || tag == 0xdf) ? 2 * length : length;
+				} break;
+				default: // 0xc1 is never used
+					return MESSAGE_INVALID;
+			}
+		}
+
+		if (p_length - offset < skip) {
+			return 0;
+		}
+		offset += static_cast<size_t>(skip);
+		pending += children;
+	}
+	return offset;
+}
+} // namespace
+
+NvimRpcMessage::~NvimRpcMessage() {
+	if (parsed) {
+		mpack_tree_destroy(&tree);
+	}
+}
+
+NvimRpcReader::~NvimRpcReader() {
+	stop();
+}
+
+bool NvimRpcReader::start(int p_fd) {
+	stop();
+	if (p_fd < 0) {
+		return false;
+	}
+
+	fd = p_fd;
+	running.store(true, std::memory_order_release);
+	thread = std::thread(&NvimRpcReader::_run, this);
+	return true;
+}
+
+void NvimRpcReader::stop() {
+	running.store(false, std::memory_order_release);
+	if (thread.joinable()) {
+		thread.join();
+	}
+	if (fd >= 0) {
+		close(fd);
+		fd = -1;
+	}
+
+	tail.clear();
+	held.clear();
+	held_redraw = false;
+	std::lock_guard<std::mutex> lock(mailbox_mutex);
+	mailbox.clear();
+	batch_held = false;
+	mailbox_has_redraw = false;
+}
+
+bool NvimRpcReader::take_messages(std::vector<std::unique_ptr<NvimRpcMessage>> &r_messages) {
+	std::lock_guard<std::mutex> lock(mailbox_mutex);
+	if (mailbox.empty()) {
+		return false;
+	}
+
+	mailbox_has_redraw = false;
+	if (r_messages.empty()) {
+		r_messages.swap(mailbox);
+	} else {
+		for (std::unique_ptr<NvimRpcMessage> &message : mailbox) {
+			r_messages.push_back(std::move(message));
+		}
+		mailbox.clear();
+	}
+	return true;
+}
+
+bool NvimRpcReader::wait_for_messages(uint64_t p_timeout_usec) {
+	std::unique_lock<std::mutex> lock(mailbox_mutex);
+	return mailbox_ready.wait_for(lock, std::chrono::microseconds(p_timeout_usec), [this]() { return !mailbox.empty(); });
+}
+
+bool NvimRpcReader::has_unfinished_batch() {
+	std::lock_guard<std::mutex> lock(mailbox_mutex);
+	return batch_held || mailbox_has_redraw;
+}
+
+void NvimRpcReader::_run() {
+	uint8_t buffer[READ_BUFFER_SIZE];
+	while (running.load(std::memory_order_acquire)) {
+		pollfd poll_fd;
+		poll_fd.fd = fd;
+		poll_fd.events = POLLIN;
+		poll_fd.revents = 0;
+		if (::poll(&poll_fd, 1, READ_POLL_TIMEOUT_MS) <= 0) {
+			continue;
+		}
+
+		std::vector<uint8_t> incoming;
+		bool reached_eof = false;
+		while (true) {
+			ssize_t read_bytes = ::read(fd, buffer, sizeof(buffer));
+			if (read_bytes > 0) {
+				incoming.insert(incoming.end(), buffer, buffer + read_bytes);
+				continue;
+			}
+			if (read_bytes == -1 && errno == EINTR) {
+				continue;
+			}
+			reached_eof = read_bytes == 0;
+			break;
+		}
+
+		if (!incoming.empty()) {
+			bytes_read.fetch_add(incoming.size(), std::memory_order_relaxed);
+			_decode(std::move(incoming));
+		}
+		if (reached_eof) {
+			// Neovim closed its stdout; hand over whatever is left and let the main
+			// thread notice the exit through NvimClient::is_running().
+			_publish();
+			break;
+		}
+	}
+}
+
+void NvimRpcReader::_decode(std::vector<uint8_t> &&p_incoming) {
+	std::shared_ptr<std::vector<uint8_t>> chunk;
+	if (tail.empty()) {
+		chunk = std::make_shared<std::vector<uint8_t>>(std::move(p_incoming));
+	} else {
+		tail.insert(tail.end(), p_incoming.begin(), p_incoming.end());
+		chunk = std::make_shared<std::vector<uint8_t>>(std::move(tail));
+		tail.clear();
+	}
+
+	size_t offset = 0;
+	while (offset < chunk->size()) {
+		const uint8_t *data = chunk->data() + offset;
+		size_t message_size = measure_message(data, chunk->size() - offset);
+		if (message_size == 0) {
+			// Partial message; keep the bytes for the next read.
+			tail.assign(chunk->begin() + static_cast<std::ptrdiff_t>(offset), chunk->end());
+			break;
+		}
+
+		std::unique_ptr<NvimRpcMessage> message = std::make_unique<NvimRpcMessage>();
+		mpack_error_t tree_error = mpack_error_invalid;
+		if (message_size != MESSAGE_INVALID) {
+			mpack_tree_init_data(&message->tree, reinterpret_cast<const char *>(data), message_size);
+			mpack_tree_parse(&message->tree);
+			tree_error = mpack_tree_error(&message->tree);
+			if (tree_error != mpack_ok) {
+				mpack_tree_destroy(&message->tree);
+			}
+		}
+		if (tree_error != mpack_ok) {
+			// The stream cannot be resynchronized; drop the rest of what was read.
+			message->error = tree_error;
+			held.push_back(std::move(message));
+			_publish();
+			break;
+		}
+
+		message->parsed = true;
+		message->chunk = chunk;
+		bool is_redraw = false;
+		bool ends_frame = _ends_frame(message->get_root(), is_redraw);
+		if (is_redraw && !held_redraw) {
+			held_redraw = true;
+			if (!ends_frame) {
+				std::lock_guard<std::mutex> lock(mailbox_mutex);
+				batch_held = true;
+			}
+		}
+		held.push_back(std::move(message));
+		offset += message_size;
+		if (ends_frame) {
+			_publish();
+		}
+	}
+}
+
+void NvimRpcReader::_publish() {
+	if (held.empty()) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mailbox_mutex);
+		for (std::unique_ptr<NvimRpcMessage> &message : held) {
+			mailbox.push_back(std::move(message));
+		}
+		mailbox_has_redraw = mailbox_has_redraw || held_redraw;
+		batch_held = false;
+	}
+	mailbox_ready.notify_all();
+	held.clear();
+	held_redraw = false;
+	frames_published.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool NvimRpcReader::_ends_frame(mpack_node_t p_root, bool &r_is_redraw) {
+	// Anything that is not a redraw notification (responses, requests, other
+	// notifications) is published immediately, together with the redraws before it.
+	if (mpack_node_type(p_root) != mpack_type_array || mpack_node_array_length(p_root) < 3) {
+		return true;
+	}
+	// Probing must not flag the tree: a type error would leave the main thread reading nil nodes.
+	mpack_node_t type_node = mpack_node_array_at(p_root, 0);
+	if ((mpack_node_type(type_node) != mpack_type_uint && mpack_node_type(type_node) != mpack_type_int) || mpack_node_i64(type_node) != 2) {
+		return true;
+	}
+	mpack_node_t method_node = mpack_node_array_at(p_root, 1);
+	if (mpack_node_type(method_node) != mpack_type_str || mpack_node_strlen(method_node) != 6 || std::memcmp(mpack_node_str(method_node), "redraw", 6) != 0) {
+		return true;
+	}
+
+	mpack_node_t batches_node = mpack_node_array_at(p_root, 2);
+	if (mpack_node_type(batches_node) != mpack_type_array) {
+		return true;
+	}
+	r_is_redraw = true;
+	size_t batch_count = mpack_node_array_length(batches_node);
+	for (size_t i = batch_count; i > 0; --i) {
+		mpack_node_t batch_node = mpack_node_array_at(batches_node, i - 1);
+		if (mpack_node_type(batch_node) != mpack_type_array || mpack_node_array_length(batch_node) == 0) {
+			continue;
+		}
+		mpack_node_t name_node = mpack_node_array_at(batch_node, 0);
+		if (mpack_node_type(name_node) == mpack_type_str && mpack_node_strlen(name_node) == 5 && std::memcmp(mpack_node_str(name_node), "flush", 5) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+} // namespace godot
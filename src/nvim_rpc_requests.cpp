@@ -0,0 +1,106 @@
+#include "nvim_rpc_requests.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace godot {
+
+void NvimRpcRequests::add(uint32_t p_msgid, Callback p_callback, uint64_t p_deadline_usec) {
+	Entry &entry = pending[p_msgid];
+	entry.callback = std::move(p_callback);
+	entry.deadline_usec = p_deadline_usec;
+	next_deadline_usec = std::min(next_deadline_usec, p_deadline_usec);
+}
+
+bool NvimRpcRequests::complete(uint32_t p_msgid, const mpack_node_t &p_error, const mpack_node_t &p_result) {
+	auto it = pending.find(p_msgid);
+	if (it == pending.end()) {
+		++responses_dropped;
+		return false;
+	}
+
+	// The callback may send further requests, so the entry leaves the table first.
+	Callback callback = std::move(it->second.callback);
+	pending.erase(it);
+
+	NvimRpcResponse response;
+	if (mpack_node_type(p_error) != mpack_type_nil) {
+		response.status = NvimRpcResponse::STATUS_ERROR;
+		response.value = &p_error;
+	} else {
+		response.value = &p_result;
+	}
+	if (callback) {
+		callback(response);
+	}
+	return true;
+}
+
+bool NvimRpcRequests::resolve(uint32_t p_msgid, const NvimRpcResponse &p_response) {
+	auto it = pending.find(p_msgid);
+	if (it == pending.end()) {
+		return false;
+	}
+
+	Callback callback = std::move(it->second.callback);
+	pending.erase(it);
+	if (callback) {
+		callback(p_response);
+	}
+	return true;
+}
+
+bool NvimRpcRequests::cancel(uint32_t p_msgid) {
+	return pending.erase(p_msgid) > 0;
+}
+
+size_t NvimRpcRequests::expire(uint64_t p_now_usec) {
+	if (p_now_usec < next_deadline_usec) {
+		return 0;
+	}
+
+	std::vector<Callback> expired;
+	for (auto it = pending.begin(); it != pending.end();) {
+		if (it->second.deadline_usec <= p_now_usec) {
+			expired.push_back(std::move(it->second.callback));
+			it = pending.erase(it);
+		} else {
+			++it;
+		}
+	}
+	_update_next_deadline();
+
+	timeouts += expired.size();
+	NvimRpcResponse response;
+	response.status = NvimRpcResponse::STATUS_TIMED_OUT;
+	for (Callback &callback : expired) {
+		if (callback) {
+			callback(response);
+		}
+	}
+	return expired.size();
+}
+
+void NvimRpcRequests::abort_all() {
+	std::unordered_map<uint32_t, Entry> aborted;
+	aborted.swap(pending);
+	next_deadline_usec = UINT64_MAX;
+
+	NvimRpcResponse response;
+	response.status = NvimRpcResponse::STATUS_ABORTED;
+	for (auto &entry : aborted) {
+		if (entry.second.callback) {
+			entry.second.callback(response);
+		}
+	}
+}
+
+void NvimRpcRequests::_update_next_deadline() {
+	next_deadline_usec = UINT64_MAX;
+	for (const auto &entry : pending) {
+		next_deadline_usec = std::min(next_deadline_usec, entry.second.deadline_usec);
+	}
+}
+
+} // namespace godot
@@ -0,0 +1,172 @@
+#include "nvim_rpc_variant.h"
+
+#include <godot_cpp/variant/array.hpp>
+#include <godot_cpp/variant/char_string.hpp>
+#include <godot_cpp/variant/dictionary.hpp>
+#include <godot_cpp/variant/packed_byte_array.hpp>
+#include <godot_cpp/variant/packed_float32_array.hpp>
+#include <godot_cpp/variant/packed_float64_array.hpp>
+#include <godot_cpp/variant/packed_int32_array.hpp>
+#include <godot_cpp/variant/packed_int64_array.hpp>
+#include <godot_cpp/variant/packed_string_array.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+namespace godot {
+
+namespace {
+void write_string(mpack_writer_t *p_writer, const String &p_value) {
+	CharString utf8 = p_value.utf8();
+	mpack_write_str(p_writer, utf8.get_data(), static_cast<uint32_t>(utf8.length()));
+}
+
+// Handles are ext payloads holding a single MessagePack integer.
+Variant decode_handle(mpack_node_t p_node) {
+	mpack_reader_t reader;
+	mpack_reader_init_data(&reader, mpack_node_data(p_node), mpack_node_data_len(p_node));
+	int64_t handle = mpack_expect_i64(&reader);
+	if (mpack_reader_destroy(&reader) != mpack_ok) {
+		return Variant();
+	}
+	return handle;
+}
+} // namespace
+
+void NvimRpcVariant::write(mpack_writer_t *p_writer, const Variant &p_value) {
+	switch (p_value.get_type()) {
+		case Variant::NIL:
+			mpack_write_nil(p_writer);
+			break;
+		case Variant::BOOL:
+			mpack_write_bool(p_writer, static_cast<bool>(p_value));
+			break;
+		case Variant::INT:
+			mpack_write_i64(p_writer, static_cast<int64_t>(p_value));
+			break;
+		case Variant::FLOAT:
+			mpack_write_double(p_writer, static_cast<double>(p_value));
+			break;
+		case Variant::STRING:
+		case Variant::STRING_NAME:
+		case Variant::NODE_PATH:
+			write_string(p_writer, p_value.stringify());
+			break;
+		case Variant::ARRAY: {
+			Array array = p_value;
+			mpack_start_array(p_writer, static_cast<uint32_t>(array.size()));
+			for (int64_t i = 0; i < array.size(); ++i) {
+				write(p_writer, array[i]);
+			}
+			mpack_finish_array(p_writer);
+		} break;
+		case Variant::DICTIONARY: {
+			Dictionary dictionary = p_value;
+			Array keys = dictionary.keys();
+			mpack_start_map(p_writer, static_cast<uint32_t>(keys.size()));
+			for (int64_t i = 0; i < keys.size(); ++i) {
+				write(p_writer, keys[i]);
+				write(p_writer, dictionary[keys[i]]);
+			}
+			mpack_finish_map(p_writer);
+		} break;
+		case Variant::PACKED_BYTE_ARRAY: {
+			PackedByteArray bytes = p_value;
+			mpack_write_bin(p_writer, reinterpret_cast<const char *>(bytes.ptr()), static_cast<uint32_t>(bytes.size()));
+		} break;
+		case Variant::PACKED_INT32_ARRAY: {
+			PackedInt32Array values = p_value;
+			mpack_start_array(p_writer, static_cast<uint32_t>(values.size()));
+			for (int64_t i = 0; i < values.size(); ++i) {
+				mpack_write_i32(p_writer, values[i]);
+			}
+			mpack_finish_array(p_writer);
+		} break;
+		case Variant::PACKED_INT64_ARRAY: {
+			PackedInt64Array values = p_value;
+			mpack_start_array(p_writer, static_cast<uint32_t>(values.size()));
+			for (int64_t i = 0; i < values.size(); ++i) {
+				mpack_write_i64(p_writer, values[i]);
+			}
+			mpack_finish_array(p_writer);
+		} break;
+		case Variant::PACKED_FLOAT32_ARRAY: {
+			PackedFloat32Array values = p_value;
+			mpack_start_array(p_writer, static_cast<uint32_t>(values.size()));
+			for (int64_t i = 0; i < values.size(); ++i) {
+				mpack_write_double(p_writer, values[i]);
+			}
+			mpack_finish_array(p_writer);
+		} break;
+		case Variant::PACKED_FLOAT64_ARRAY: {
+			PackedFloat64Array values = p_value;
+			mpack_start_array(p_writer, static_cast<uint32_t>(values.size()));
+			for (int64_t i = 0; i < values.size(); ++i) {
+				mpack_write_double(p_writer, values[i]);
+			}
+			mpack_finish_array(p_writer);
+		} break;
+		case Variant::PACKED_STRING_ARRAY: {
+			PackedStringArray values = p_value;
+			mpack_start_array(p_writer, static_cast<uint32_t>(values.size()));
+			for (int64_t i = 0; i < values.size(); ++i) {
+				write_string(p_writer, values[i]);
+			}
+			mpack_finish_array(p_writer);
+		} break;
+		default:
+			write_string(p_writer, p_value.stringify());
+			break;
+	}
+}
+
+Variant NvimRpcVariant::from_node(mpack_node_t p_node) {
+	switch (mpack_node_type(p_node)) {
+		case mpack_type_bool:
+			return mpack_node_bool(p_node);
+		case mpack_type_int:
+			return mpack_node_i64(p_node);
+		case mpack_type_uint: {
+			uint64_t value = mpack_node_u64(p_node);
+			return static_cast<int64_t>(value > static_cast<uint64_t>(std::numeric_limits<int64_t>::max()) ? std::numeric_limits<int64_t>::max() : value);
+		}
+		case mpack_type_float:
+		case mpack_type_double:
+			return mpack_node_double(p_node);
+		case mpack_type_str:
+			return String::utf8(mpack_node_str(p_node), static_cast<int64_t>(mpack_node_strlen(p_node)));
+		case mpack_type_bin: {
+			PackedByteArray bytes;
+			uint32_t length = mpack_node_data_len(p_node);
+			bytes.resize(length);
+			if (length > 0) {
+				std::memcpy(bytes.ptrw(), mpack_node_data(p_node), length);
+			}
+			return bytes;
+		}
+		case mpack_type_array: {
+			Array array;
+			size_t count = mpack_node_array_length(p_node);
+			array.resize(static_cast<int64_t>(count));
+			for (size_t i = 0; i < count; ++i) {
+				array[static_cast<int64_t>(i)] = from_node(mpack_node_array_at(p_node, i));
+			}
+			return array;
+		}
+		case mpack_type_map: {
+			Dictionary dictionary;
+			size_t count = mpack_node_map_count(p_node);
+			for (size_t i = 0; i < count; ++i) {
+				dictionary[from_node(mpack_node_map_key_at(p_node, i))] = from_node(mpack_node_map_value_at(p_node, i));
+			}
+			return dictionary;
+		}
+		case mpack_type_ext:
+			return decode_handle(p_node);
+		default:
+			return Variant();
+	}
+}
+
+} // namespace godot
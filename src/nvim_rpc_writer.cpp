@@ -0,0 +1,115 @@
+#include "nvim_rpc_writer.h"
+
+#include <godot_cpp/variant/utility_functions.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <sys/uio.h>
+
+namespace godot {
+
+NvimRpcWriter::NvimRpcWriter() {
+	// One block covers a typical frame of keys, mouse events and a resize.
+	blocks.push_back(std::make_unique<char[]>(BLOCK_SIZE));
+}
+
+bool NvimRpcWriter::flush(NvimClient *p_client) {
+	if (!has_pending()) {
+		return true;
+	}
+
+	std::vector<iovec> segments;
+	segments.reserve(block_index + 1);
+	size_t first_block = sent_bytes / BLOCK_SIZE;
+	for (size_t i = first_block; i <= block_index; ++i) {
+		size_t start = i == first_block ? sent_bytes % BLOCK_SIZE : 0;
+		size_t end = i < block_index ? BLOCK_SIZE : block_used;
+		if (end > start) {
+			segments.push_back(iovec{ blocks[i].get() + start, end - start });
+		}
+	}
+
+	size_t written = 0;
+	bool ok = p_client && p_client->write_vectored(segments.data(), segments.size(), written);
+	++flushes;
+	bytes_written += written;
+	if (!ok) {
+		UtilityFunctions::printerr("[nvim_embed] Failed to write queued RPC messages (", static_cast<int64_t>(written), "/", static_cast<int64_t>(get_pending_bytes()), " bytes)");
+		clear();
+		return false;
+	}
+
+	sent_bytes += written;
+	if (sent_bytes == pending_bytes) {
+		clear();
+		return true;
+	}
+
+	// Neovim is not keeping up. Fully sent blocks move behind the rest so the arena stays
+	// bounded while the backlog drains over the next frames.
+	++partial_flushes;
+	size_t sent_blocks = sent_bytes / BLOCK_SIZE;
+	if (sent_blocks > 0) {
+		std::rotate(blocks.begin(), blocks.begin() + static_cast<std::ptrdiff_t>(sent_blocks), blocks.begin() + static_cast<std::ptrdiff_t>(block_index + 1));
+		block_index -= sent_blocks;
+		sent_bytes -= sent_blocks * BLOCK_SIZE;
+		pending_bytes -= sent_blocks * BLOCK_SIZE;
+	}
+	return true;
+}
+
+void NvimRpcWriter::clear() {
+	block_index = 0;
+	block_used = 0;
+	pending_bytes = 0;
+	sent_bytes = 0;
+}
+
+mpack_writer_t *NvimRpcWriter::_begin_message() {
+	message_block_index = block_index;
+	message_block_used = block_used;
+	mpack_writer_init(&writer, stage, sizeof(stage));
+	mpack_writer_set_context(&writer, this);
+	mpack_writer_set_flush(&writer, &NvimRpcWriter::_flush_stage);
+	return &writer;
+}
+
+bool NvimRpcWriter::_end_message(const char *p_method) {
+	mpack_error_t writer_error = mpack_writer_destroy(&writer);
+	if (writer_error != mpack_ok) {
+		// Roll back whatever part of the message already reached the arena.
+		size_t kept = message_block_index * BLOCK_SIZE + message_block_used;
+		size_t reached = block_index * BLOCK_SIZE + block_used;
+		pending_bytes -= reached - kept;
+		block_index = message_block_index;
+		block_used = message_block_used;
+		UtilityFunctions::printerr("[nvim_embed] Failed to encode ", p_method, " (error code ", static_cast<int64_t>(writer_error), ")");
+		return false;
+	}
+	++messages_encoded;
+	return true;
+}
+
+void NvimRpcWriter::_append(const char *p_data, size_t p_length) {
+	while (p_length > 0) {
+		if (block_used == BLOCK_SIZE) {
+			++block_index;
+			block_used = 0;
+			if (block_index == blocks.size()) {
+				blocks.push_back(std::make_unique<char[]>(BLOCK_SIZE));
+			}
+		}
+		size_t count = std::min(p_length, BLOCK_SIZE - block_used);
+		std::memcpy(blocks[block_index].get() + block_used, p_data, count);
+		block_used += count;
+		pending_bytes += count;
+		p_data += count;
+		p_length -= count;
+	}
+}
+
+void NvimRpcWriter::_flush_stage(mpack_writer_t *p_writer, const char *p_data, size_t p_length) {
+	static_cast<NvimRpcWriter *>(mpack_writer_context(p_writer))->_append(p_data, p_length);
+}
+
+} // namespace godot
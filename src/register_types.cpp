@@ -2,6 +2,7 @@
 
 #include "nvim_editor_plugin.h"
 #include "nvim_panel.h"
+#include "nvim_request.h"
 
 #include <gdextension_interface.h>
 
@@ -15,6 +16,7 @@ void initialize_nvim_embed_module(ModuleInitializationLevel p_level) {
 	if (p_level == MODULE_INITIALIZATION_LEVEL_SCENE) {
 		GDREGISTER_CLASS(NvimGridCanvas);
 		GDREGISTER_CLASS(NvimPanel);
+		GDREGISTER_CLASS(NvimRequest);
 	}
 
 	if (p_level == MODULE_INITIALIZATION_LEVEL_EDITOR) {